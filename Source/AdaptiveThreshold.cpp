@@ -0,0 +1,107 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AdaptiveThreshold.h"
+#include <algorithm> // min, max
+
+AdaptiveThreshold::AdaptiveThreshold()
+    : level            (0.99f)
+    , horizon          (0)
+    , requestedLevel   (0.99f)
+    , requestedHorizon (0)
+{
+    prepare(1);
+}
+
+void AdaptiveThreshold::prepare(int newNumChannels)
+{
+    trackers.assign(std::max(newNumChannels, 1), QuantileTracker());
+
+    level = requestedLevel.load();
+    horizon = requestedHorizon.load();
+    const double probability = level;
+    for (QuantileTracker& tracker : trackers)
+    {
+        tracker.setQuantiles(&probability, 1);
+        tracker.setHorizon(horizon);
+    }
+}
+
+void AdaptiveThreshold::setLevel(float newLevel)
+{
+    requestedLevel = std::min(std::max(newLevel, 0.001f), 0.999f);
+}
+
+void AdaptiveThreshold::setHorizon(int newHorizon)
+{
+    requestedHorizon = std::max(newHorizon, 0);
+}
+
+void AdaptiveThreshold::reset()
+{
+    for (QuantileTracker& tracker : trackers)
+        tracker.reset();
+}
+
+void AdaptiveThreshold::beginBlock()
+{
+    const float newLevel = requestedLevel.load();
+    if (newLevel != level)
+    {
+        level = newLevel;
+        const double probability = level;
+        for (QuantileTracker& tracker : trackers)
+            tracker.setQuantiles(&probability, 1);
+    }
+
+    const int newHorizon = requestedHorizon.load();
+    if (newHorizon != horizon)
+    {
+        horizon = newHorizon;
+        for (QuantileTracker& tracker : trackers)
+            tracker.setHorizon(horizon);
+    }
+}
+
+void AdaptiveThreshold::process(const float* const* in, float* const* threshold, int nSamples)
+{
+    beginBlock();
+
+    for (int c = 0; c < getNumChannels(); c++)
+    {
+        QuantileTracker& tracker = trackers[c];
+        const float* x = in[c];
+        float* out = threshold[c];
+
+        for (int i = 0; i < nSamples; i++)
+        {
+            tracker.add(x[i]);
+            out[i] = static_cast<float>(tracker.getQuantile(0));
+        }
+    }
+}
+
+float AdaptiveThreshold::getThreshold(int channel) const
+{
+    return static_cast<float>(trackers[channel].getQuantile(0));
+}
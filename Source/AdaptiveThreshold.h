@@ -0,0 +1,79 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Detection threshold that adapts to each channel's own output, so that it doesn't have to be tuned
+// by hand for every animal and doesn't go stale as the signal drifts over a session.
+// The threshold is a running estimate of a high quantile of the integrator output (e.g. the 99th
+// percentile: the level it stays below 99% of the time), tracked per channel by a QuantileTracker in
+// constant memory and time, either over the whole session or over a decaying horizon.
+// The level and horizon may be changed from another thread while processing; like the rolling window,
+// they take effect at the start of the next block (see beginBlock). A new level starts the estimate
+// over; a new horizon carries on with it.
+
+#ifndef ADAPTIVE_THRESHOLD_H_INCLUDED
+#define ADAPTIVE_THRESHOLD_H_INCLUDED
+
+#include "QuantileTracker.h"
+#include <atomic>
+#include <vector>
+
+class AdaptiveThreshold
+{
+public:
+    AdaptiveThreshold();
+
+    // one tracker per channel, all starting over; must not be called while processing
+    void prepare(int newNumChannels);
+    int getNumChannels() const { return static_cast<int>(trackers.size()); }
+
+    // quantile of the input used as the threshold, between 0 and 1 exclusive (default 0.99)
+    void setLevel(float newLevel);
+    float getLevel() const { return requestedLevel.load(); }
+
+    // number of samples over which old samples are forgotten, or 0 to use the whole session (default)
+    void setHorizon(int newHorizon);
+    int getHorizon() const { return requestedHorizon.load(); }
+
+    // starts the estimates over; must not be called while processing
+    void reset();
+
+    // applies a pending change of level or horizon; call at the start of each block
+    void beginBlock();
+
+    // adds nSamples of each of getNumChannels() channels; threshold[c][i] receives channel c's threshold
+    // after sample i. in[c] and threshold[c] may point to the same buffer.
+    void process(const float* const* in, float* const* threshold, int nSamples);
+
+    // channel's threshold after the last sample processed
+    float getThreshold(int channel) const;
+
+private:
+    std::vector<QuantileTracker> trackers;
+
+    float level;                    // in use by the processing thread
+    int horizon;
+    std::atomic<float> requestedLevel;
+    std::atomic<int> requestedHorizon;
+};
+
+#endif
@@ -0,0 +1,123 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "AllocationCheck.h"
+
+#ifdef MBI_ALLOCATION_CHECK
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#define MBI_THREAD_LOCAL __declspec(thread)
+#else
+#define MBI_THREAD_LOCAL __thread
+#endif
+
+namespace
+{
+    // depth of nested ScopedNoAllocations on this thread
+    MBI_THREAD_LOCAL int noAllocationDepth = 0;
+
+    void* checkedAlloc(size_t size)
+    {
+        if (noAllocationDepth > 0)
+        {
+            std::fprintf(stderr, "Multi-band Integrator: %lu-byte heap allocation in the audio path\n",
+                         static_cast<unsigned long>(size));
+            std::abort();
+        }
+
+        return std::malloc(size == 0 ? 1 : size);
+    }
+
+    void checkedFree(void* p)
+    {
+        if (p != nullptr && noAllocationDepth > 0)
+        {
+            std::fprintf(stderr, "Multi-band Integrator: heap deallocation in the audio path\n");
+            std::abort();
+        }
+
+        std::free(p);
+    }
+}
+
+ScopedNoAllocation::ScopedNoAllocation()
+{
+    noAllocationDepth++;
+}
+
+ScopedNoAllocation::~ScopedNoAllocation()
+{
+    noAllocationDepth--;
+}
+
+void* operator new(size_t size)
+{
+    void* p = checkedAlloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = checkedAlloc(size);
+    if (p == nullptr)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) throw()
+{
+    return checkedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) throw()
+{
+    return checkedAlloc(size);
+}
+
+void operator delete(void* p) throw()
+{
+    checkedFree(p);
+}
+
+void operator delete[](void* p) throw()
+{
+    checkedFree(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) throw()
+{
+    checkedFree(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) throw()
+{
+    checkedFree(p);
+}
+
+#endif // MBI_ALLOCATION_CHECK
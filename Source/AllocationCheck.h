@@ -0,0 +1,49 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Test-mode check that the audio path never touches the heap.
+// Build with MBI_ALLOCATION_CHECK defined to replace the global operator new / delete with versions that
+// abort with a message if they are called on a thread that is inside a ScopedNoAllocation. Without the
+// define, ScopedNoAllocation does nothing and the global operators are left alone.
+// Note that the replacement operators are global to the whole process the plugin is loaded into,
+// so this is meant for test builds only.
+
+#ifndef ALLOCATION_CHECK_H_INCLUDED
+#define ALLOCATION_CHECK_H_INCLUDED
+
+class ScopedNoAllocation
+{
+public:
+#ifdef MBI_ALLOCATION_CHECK
+    ScopedNoAllocation();
+    ~ScopedNoAllocation();
+#else
+    ScopedNoAllocation() {}
+#endif
+
+private:
+    ScopedNoAllocation(const ScopedNoAllocation&);
+    ScopedNoAllocation& operator=(const ScopedNoAllocation&);
+};
+
+#endif
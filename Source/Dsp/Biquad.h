@@ -37,6 +37,7 @@ THE SOFTWARE.
 #define DSPFILTERS_BIQUAD_H
 
 #include "Common.h"
+#include "Denormal.h"
 #include "MathSupplement.h"
 #include "Types.h"
 
@@ -56,13 +57,35 @@ class BiquadBase
 {
 public:
     template <class StateType>
-    struct State : StateType, private DenormalPrevention
+    struct State : StateType
     {
+        typedef StateType form_type;
+        typedef typename DenormalPolicyOf<StateType>::type denormal_type;
+
+        // for processing that steps through the stages itself (see ChannelsProcessor)
+        StateType& getStageState(int)
+        {
+            return *this;
+        }
+
+        denormal_type& getDenormal()
+        {
+            return m_denormal;
+        }
+
+        double nextDenormalOffset()
+        {
+            return m_denormal.next();
+        }
+
         template <typename Sample>
         inline Sample process(const Sample in, const BiquadBase& b)
         {
-            return static_cast<Sample>(StateType::process1(in, b, ac()));
+            return static_cast<Sample>(StateType::process1(in, b, m_denormal.next()));
         }
+
+    private:
+        denormal_type m_denormal;
     };
 
 public:
@@ -100,6 +123,8 @@ public:
     template <class StateType, typename Sample>
     void process(int numSamples, Sample* dest, StateType& state) const
     {
+        const typename StateType::denormal_type::Scope scope;
+
         while (--numSamples >= 0)
         {
             *dest = state.process(*dest, *this);
@@ -247,6 +272,11 @@ public:
     {
         BiquadBase::applyScale(scale);
     }
+
+    void setIdentity()
+    {
+        BiquadBase::setIdentity();
+    }
 };
 
 }
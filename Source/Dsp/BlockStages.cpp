@@ -0,0 +1,94 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "BlockStages.h"
+
+namespace Dsp
+{
+
+void processStageBlock(const BiquadBase* stages, int numStages,
+                       double* v1, double* v2, double* x, size_t numSamples)
+{
+    int k = 0;
+    for (; k + 1 < numStages; k += 2)
+    {
+        const BiquadBase& s = stages[k];
+        const BiquadBase& t = stages[k + 1];
+        const double sb0 = s.m_b0, sb1 = s.m_b1, sb2 = s.m_b2, sa1 = s.m_a1, sa2 = s.m_a2;
+        const double tb0 = t.m_b0, tb1 = t.m_b1, tb2 = t.m_b2, ta1 = t.m_a1, ta2 = t.m_a2;
+        double s1 = v1[k], s2 = v2[k];
+        double t1 = v1[k + 1], t2 = v2[k + 1];
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const double sw = x[i] - sa1 * s1 - sa2 * s2;
+            const double y = sb0 * sw + sb1 * s1 + sb2 * s2;
+            s2 = s1;
+            s1 = sw;
+
+            const double tw = y - ta1 * t1 - ta2 * t2;
+            x[i] = tb0 * tw + tb1 * t1 + tb2 * t2;
+            t2 = t1;
+            t1 = tw;
+        }
+
+        v1[k] = s1;
+        v2[k] = s2;
+        v1[k + 1] = t1;
+        v2[k + 1] = t2;
+    }
+
+    if (k < numStages)
+    {
+        const BiquadBase& s = stages[k];
+        const double b0 = s.m_b0, b1 = s.m_b1, b2 = s.m_b2, a1 = s.m_a1, a2 = s.m_a2;
+        double s1 = v1[k], s2 = v2[k];
+
+        for (size_t i = 0; i < numSamples; ++i)
+        {
+            const double w = x[i] - a1 * s1 - a2 * s2;
+            x[i] = b0 * w + b1 * s1 + b2 * s2;
+            s2 = s1;
+            s1 = w;
+        }
+
+        v1[k] = s1;
+        v2[k] = s2;
+    }
+}
+
+}
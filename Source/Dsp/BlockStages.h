@@ -0,0 +1,63 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_BLOCKSTAGES_H
+#define DSPFILTERS_BLOCKSTAGES_H
+
+#include "Common.h"
+#include "Biquad.h"
+
+#include <cstddef>
+
+namespace Dsp
+{
+
+/*
+ * The inner loop of the offline filters (ZeroPhaseFilter, SegmentedFilter).
+ *
+ * Runs numSamples samples of x, in place, through every stage in turn, in
+ * Direct Form II with no denormal offset; v1 and v2 hold the state of each
+ * stage. The stages are taken two at a time, so that the recurrences of
+ * both are worked on together. Each stage computes exactly what
+ * DirectFormII::process1 does with no offset.
+ *
+ */
+void processStageBlock(const BiquadBase* stages, int numStages,
+                       double* v1, double* v2, double* x, size_t numSamples);
+
+}
+
+#endif
@@ -53,6 +53,14 @@ void Cascade::setCascadeStorage(const Storage& storage)
     m_stageArray = storage.stageArray;
 }
 
+void Cascade::setNumStages(int numStages)
+{
+    assert(numStages >= 0 && numStages <= m_maxStages);
+    for (int i = m_numStages; i < numStages; ++i)
+        m_stageArray[i].setIdentity();
+    m_numStages = numStages;
+}
+
 complex_t Cascade::response(double normalizedFrequency) const
 {
     double w = 2 * doublePi * normalizedFrequency;
@@ -50,21 +50,91 @@ namespace Dsp
  *
  */
 
+/*
+ * Runs a block of samples through a cascade of exactly NumStages stages.
+ * The number of stages being a constant, the loop over them unrolls, and
+ * the coefficients and the state are copied into locals for the length of
+ * the block so that they can stay in registers. The result is the same as
+ * stepping through the cascade's stages one sample at a time.
+ *
+ * Cascade::process() uses this for cascades of up to maxFixedStages stages.
+ *
+ */
+template <int NumStages>
+struct FixedCascade
+{
+    template <class StateType, typename Sample>
+    static void process(int numSamples,
+                        Sample* dest,
+                        StateType& state,
+                        const BiquadBase* stageArray)
+    {
+        typedef typename StateType::form_type Form;
+
+        if (numSamples <= 0)
+            return;
+
+        BiquadBase stages[NumStages];
+        Form forms[NumStages];
+        for (int i = 0; i < NumStages; ++i)
+        {
+            stages[i] = stageArray[i];
+            forms[i] = state.getStageState(i);
+        }
+
+        // the denormal offsets are taken from a copy of the policy, which can stay in a register
+        typename StateType::denormal_type denormal = state.getDenormal();
+
+        for (int n = 0; n < numSamples; ++n)
+        {
+            double out = dest[n];
+            out = forms[0].process1(out, stages[0], denormal.next());
+            for (int i = 1; i < NumStages; ++i)
+                out = forms[i].process1(out, stages[i], 0);
+            dest[n] = static_cast<Sample>(out);
+        }
+
+        state.getDenormal() = denormal;
+
+        for (int i = 0; i < NumStages; ++i)
+            state.getStageState(i) = forms[i];
+    }
+};
+
 // Factored implementation to reduce template instantiations
 class Cascade
 {
 public:
     template <class StateType>
-    class StateBase : private DenormalPrevention
+    class StateBase
     {
     public:
+        typedef StateType form_type;
+        typedef typename DenormalPolicyOf<StateType>::type denormal_type;
+
+        // for processing that steps through the stages itself (see ChannelsProcessor)
+        StateType& getStageState(int index)
+        {
+            return m_stateArray[index];
+        }
+
+        denormal_type& getDenormal()
+        {
+            return m_denormal;
+        }
+
+        double nextDenormalOffset()
+        {
+            return m_denormal.next();
+        }
+
         template <typename Sample>
         inline Sample process(const Sample in, const Cascade& c)
         {
             double out = in;
             StateType* state = m_stateArray;
             Biquad const* stage = c.m_stageArray;
-            const double vsa = ac();
+            const double vsa = m_denormal.next();
             int i = c.m_numStages - 1;
             out = (state++)->process1(out, *stage++, vsa);
             for (; --i >= 0;)
@@ -82,6 +152,9 @@ public:
 
     protected:
         StateType* m_stateArray;
+
+    private:
+        denormal_type m_denormal;
     };
 
     struct Stage : Biquad
@@ -111,16 +184,50 @@ public:
         return m_stageArray[index];
     }
 
+    // Direct access to the coefficients, for filters whose coefficients are
+    // changed sample by sample rather than designed (see SmoothedFilterDesign).
+    // Stages added by setNumStages pass their input through unchanged.
+    Stage& getStage(int index)
+    {
+        assert(index >= 0 && index < m_maxStages);
+        return m_stageArray[index];
+    }
+
+    void setNumStages(int numStages);
+
 public:
     // Calculate filter response at the given normalized frequency.
     complex_t response(double normalizedFrequency) const;
 
     std::vector<PoleZeroPair> getPoleZeros() const;
 
+    enum
+    {
+        maxFixedStages = 4
+    };
+
     // Process a block of samples in the given form
     template <class StateType, typename Sample>
     void process(int numSamples, Sample* dest, StateType& state) const
     {
+        const typename StateType::denormal_type::Scope scope;
+
+        switch (m_numStages)
+        {
+            case 1:
+                FixedCascade <1>::process(numSamples, dest, state, m_stageArray);
+                return;
+            case 2:
+                FixedCascade <2>::process(numSamples, dest, state, m_stageArray);
+                return;
+            case 3:
+                FixedCascade <3>::process(numSamples, dest, state, m_stageArray);
+                return;
+            case 4:
+                FixedCascade <4>::process(numSamples, dest, state, m_stageArray);
+                return;
+        }
+
         while (--numSamples >= 0)
         {
             *dest = state.process(*dest, *this);
@@ -180,6 +287,40 @@ private:
     Cascade::Stage m_stages[MaxStages];
 };
 
+//------------------------------------------------------------------------------
+
+// Coefficient access that works on cascades and single biquads alike
+// (see SmoothedFilterDesign and DesignCache)
+
+inline int getDesignNumStages(Cascade& cascade)
+{
+    return cascade.getNumStages();
+}
+
+inline int getDesignNumStages(BiquadBase&)
+{
+    return 1;
+}
+
+inline void setDesignNumStages(Cascade& cascade, int numStages)
+{
+    cascade.setNumStages(numStages);
+}
+
+inline void setDesignNumStages(BiquadBase&, int)
+{
+}
+
+inline BiquadBase& getDesignStage(Cascade& cascade, int index)
+{
+    return cascade.getStage(index);
+}
+
+inline BiquadBase& getDesignStage(BiquadBase& biquad, int)
+{
+    return biquad;
+}
+
 }
 
 #endif
@@ -0,0 +1,91 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "Denormal.h"
+#include "VectorSupport.h"
+
+namespace Dsp
+{
+
+// MXCSR bits: flush to zero (FTZ) and denormals are zero (DAZ)
+// FPCR bit: flush to zero (FZ), which on ARMv8 covers inputs and outputs
+
+#if defined(DSP_VECTOR_X86) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+
+ScopedFlushToZero::ScopedFlushToZero()
+    : m_previousMode(_mm_getcsr())
+{
+    _mm_setcsr(static_cast<unsigned int>(m_previousMode) | 0x8040);
+}
+
+ScopedFlushToZero::~ScopedFlushToZero()
+{
+    _mm_setcsr(static_cast<unsigned int>(m_previousMode));
+}
+
+#elif defined(__aarch64__) && defined(__GNUC__)
+
+ScopedFlushToZero::ScopedFlushToZero()
+{
+    unsigned long long mode;
+    __asm__ __volatile__("mrs %0, fpcr" : "=r"(mode));
+    m_previousMode = mode;
+    mode |= 1ULL << 24;
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+}
+
+ScopedFlushToZero::~ScopedFlushToZero()
+{
+    const unsigned long long mode = m_previousMode;
+    __asm__ __volatile__("msr fpcr, %0" : : "r"(mode));
+}
+
+#else
+
+// no control over the mode; the filter runs without protection
+ScopedFlushToZero::ScopedFlushToZero()
+    : m_previousMode(0)
+{
+}
+
+ScopedFlushToZero::~ScopedFlushToZero()
+{
+}
+
+#endif
+
+}
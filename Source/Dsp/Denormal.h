@@ -0,0 +1,191 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_DENORMAL_H
+#define DSPFILTERS_DENORMAL_H
+
+#include "Common.h"
+#include "MathSupplement.h"
+
+namespace Dsp
+{
+
+/*
+ * Denormal policies for the filter states.
+ *
+ * A recursive filter whose input falls silent decays towards zero, and on
+ * the way its state passes through denormal numbers, which many CPUs handle
+ * hundreds of times slower than normal ones. By default each state adds a
+ * tiny alternating offset (DenormalPrevention::ac) into its first stage to
+ * keep the state away from them. That offset is a signal of its own, about
+ * 1e-8 in size, and as it changes from sample to sample, the samples of a
+ * block can't be worked on independently.
+ *
+ * The policy of a state is chosen with its form:
+ *
+ *  SimpleFilter <Butterworth::BandPass <2>, 2,
+ *                DenormalForm <DirectFormII, DenormalFlushToZero> > f;
+ *
+ *  DenormalAC           the alternating offset (the default)
+ *  DenormalDC           a constant offset of the same size
+ *  DenormalNone         no offset and no protection
+ *  DenormalFlushToZero  no offset; the CPU flushes denormals to zero
+ *                       (FTZ/DAZ) while a block is processed, and is put
+ *                       back into its previous mode afterwards
+ *
+ * Flushing is as fast as the offsets and, unlike them, leaves quiet signals
+ * alone; it works with SSE on x86 and on 64-bit ARM, and does nothing
+ * elsewhere. Without any protection, a filter whose input has died away
+ * can be 50 times slower (see Tools/Benchmark).
+ * Its scope covers the processing of the filter only: anything else run on
+ * the same thread meanwhile (e.g. from the sample loop of a SmoothedFilter)
+ * sees the mode too. Results of the filter itself differ from those of an
+ * unprotected one only where a value would have been denormal.
+ *
+ * Each policy gives the offset for every sample (next), can skip ahead over
+ * a number of samples (skip), and has a Scope that is held while a block is
+ * processed.
+ *
+ */
+
+// Puts the CPU into flush-to-zero and denormals-are-zero mode for its lifetime
+class ScopedFlushToZero
+{
+public:
+    ScopedFlushToZero();
+    ~ScopedFlushToZero();
+
+private:
+    ScopedFlushToZero(const ScopedFlushToZero&);
+    ScopedFlushToZero& operator=(const ScopedFlushToZero&);
+
+    unsigned long long m_previousMode;
+};
+
+// Nothing to do around a block
+struct NoDenormalScope
+{
+    NoDenormalScope()
+    {
+    }
+};
+
+class DenormalAC : private DenormalPrevention
+{
+public:
+    typedef NoDenormalScope Scope;
+
+    double next()
+    {
+        return ac();
+    }
+
+    void skip(int numSamples)
+    {
+        if (numSamples & 1)
+            ac();
+    }
+};
+
+class DenormalDC
+{
+public:
+    typedef NoDenormalScope Scope;
+
+    double next()
+    {
+        return DenormalPrevention::dc();
+    }
+
+    void skip(int)
+    {
+    }
+};
+
+class DenormalNone
+{
+public:
+    typedef NoDenormalScope Scope;
+
+    double next()
+    {
+        return 0;
+    }
+
+    void skip(int)
+    {
+    }
+};
+
+class DenormalFlushToZero
+{
+public:
+    typedef ScopedFlushToZero Scope;
+
+    double next()
+    {
+        return 0;
+    }
+
+    void skip(int)
+    {
+    }
+};
+
+//------------------------------------------------------------------------------
+
+// A state form with the given denormal policy
+template <class FormType, class DenormalPolicy>
+class DenormalForm : public FormType
+{
+};
+
+// The denormal policy of a state form
+template <class FormType>
+struct DenormalPolicyOf
+{
+    typedef DenormalAC type;
+};
+
+template <class FormType, class DenormalPolicy>
+struct DenormalPolicyOf <DenormalForm <FormType, DenormalPolicy> >
+{
+    typedef DenormalPolicy type;
+};
+
+}
+
+#endif
@@ -0,0 +1,177 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "DesignCache.h"
+
+#include <algorithm>
+
+namespace Dsp
+{
+
+namespace
+{
+
+DesignCache sharedCache;
+
+}
+
+DesignCache::Key::Key(const std::type_info& type_, int numParams_, const Params& params_)
+    : type(&type_)
+    , numParams(numParams_)
+{
+    params.clear();
+    for (int i = 0; i < numParams; ++i)
+        params[i] = params_[i];
+}
+
+bool DesignCache::Key::operator<(const Key& other) const
+{
+    if (*type != *other.type)
+        return type->before(*other.type);
+    for (int i = 0; i < numParams; ++i)
+    {
+        if (params[i] != other.params[i])
+            return params[i] < other.params[i];
+    }
+    return false;
+}
+
+DesignCache::DesignCache(int capacity)
+    : m_capacity(std::max(capacity, 1))
+{
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.evictions = 0;
+}
+
+DesignCache& DesignCache::getShared()
+{
+    return sharedCache;
+}
+
+int DesignCache::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_capacity;
+}
+
+void DesignCache::setCapacity(int capacity)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_capacity = std::max(capacity, 1);
+    trim();
+}
+
+void DesignCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_index.clear();
+    m_list.clear();
+}
+
+DesignCache::Stats DesignCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Stats stats = m_stats;
+    stats.size = static_cast<int>(m_index.size());
+    stats.capacity = m_capacity;
+    return stats;
+}
+
+void DesignCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stats.hits = 0;
+    m_stats.misses = 0;
+    m_stats.evictions = 0;
+}
+
+const DesignCache::Entry* DesignCache::find(const Key& key)
+{
+    std::map<Key, List::iterator>::iterator found = m_index.find(key);
+    if (found == m_index.end())
+    {
+        ++m_stats.misses;
+        return 0;
+    }
+
+    ++m_stats.hits;
+    m_list.splice(m_list.begin(), m_list, found->second);
+    return &found->second->second;
+}
+
+void DesignCache::insert(const Key& key, const Entry& entry)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // another thread may have designed the same filter in the meantime
+    std::map<Key, List::iterator>::iterator found = m_index.find(key);
+    if (found != m_index.end())
+    {
+        m_list.splice(m_list.begin(), m_list, found->second);
+        return;
+    }
+
+    m_list.push_front(std::make_pair(key, entry));
+    m_index.insert(std::make_pair(key, m_list.begin()));
+    trim();
+}
+
+void DesignCache::trim()
+{
+    while (static_cast<int>(m_index.size()) > m_capacity)
+    {
+        m_index.erase(m_list.back().first);
+        m_list.pop_back();
+        ++m_stats.evictions;
+    }
+}
+
+void DesignCache::restoreStages(Cascade& design, const Entry& entry)
+{
+    const int numStages = static_cast<int>(entry.stages.size());
+    design.setNumStages(numStages);
+    for (int i = 0; i < numStages; ++i)
+        static_cast<BiquadBase&>(design.getStage(i)) = entry.stages[i];
+}
+
+void DesignCache::restoreStages(BiquadBase& design, const Entry& entry)
+{
+    design = entry.stages[0];
+}
+
+}
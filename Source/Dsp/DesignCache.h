@@ -0,0 +1,189 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_DESIGNCACHE_H
+#define DSPFILTERS_DESIGNCACHE_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "Params.h"
+#include "PoleFilter.h"
+
+#include <list>
+#include <map>
+#include <mutex>
+#include <typeinfo>
+
+namespace Dsp
+{
+
+/*
+ * Remembers the coefficients of recently designed filters.
+ *
+ * Designing a filter from its parameters means laying out the analog
+ * prototype, transforming it and working out every section (for Bessel
+ * and Legendre filters, with an iterative root finder). Instances that
+ * share settings, settings that are reloaded and sweeps that come back to
+ * the same point all repeat that work. setParams() looks the design up by
+ * its class (which implies family and kind) and parameters and copies in
+ * the stored coefficients
+ * (and the pole/zero layout of pole filters), designing the filter and
+ * storing the result only on a miss. The output is the same either way.
+ *
+ * The cache holds up to getCapacity() designs and drops the least recently
+ * used one when full. It is safe to use from several threads at once; the
+ * designing itself happens outside the lock. Misses allocate, so this is
+ * for control threads, not for audio callbacks.
+ *
+ */
+class DesignCache
+{
+public:
+    struct Stats
+    {
+        long long hits;
+        long long misses;
+        long long evictions;
+        int size;
+        int capacity;
+    };
+
+    explicit DesignCache(int capacity = 256);
+
+    // one cache shared by everything in the process
+    static DesignCache& getShared();
+
+    // Sets up any design class (e.g. Butterworth::Design::LowPass <4>,
+    // RBJ::Design::HighPass) for the given parameters, from the cache if
+    // possible. Returns true on a hit.
+    template <class DesignClass>
+    bool setParams(DesignClass& design, const Params& params)
+    {
+        const Key key(typeid(DesignClass), DesignClass::NumParams, params);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (const Entry* entry = find(key))
+            {
+                restore(design, *entry);
+                return true;
+            }
+        }
+
+        design.setParams(params);
+
+        Entry entry;
+        const int numStages = getDesignNumStages(design);
+        entry.stages.resize(numStages);
+        for (int i = 0; i < numStages; ++i)
+            entry.stages[i] = getDesignStage(design, i);
+        entry.poleZeros = design.getPoleZeros();
+        insert(key, entry);
+        return false;
+    }
+
+    int getCapacity() const;
+
+    // drops the least recently used designs if there are more than the new capacity
+    void setCapacity(int capacity);
+
+    void clear();
+
+    Stats getStats() const;
+    void resetStats();
+
+private:
+    struct Key
+    {
+        Key(const std::type_info& type_, int numParams_, const Params& params_);
+
+        bool operator<(const Key& other) const;
+
+        const std::type_info* type;
+        int numParams;
+        Params params;      // only the first numParams are used
+    };
+
+    struct Entry
+    {
+        std::vector<BiquadBase> stages;
+        std::vector<PoleZeroPair> poleZeros;
+    };
+
+    // most recently used first
+    typedef std::list<std::pair<Key, Entry> > List;
+
+    // with m_mutex held
+    const Entry* find(const Key& key);
+    void trim();
+
+    void insert(const Key& key, const Entry& entry);
+
+    static void restoreStages(Cascade& design, const Entry& entry);
+    static void restoreStages(BiquadBase& design, const Entry& entry);
+
+    template <class DesignClass>
+    static void restore(DesignClass& design, const Entry& entry)
+    {
+        restoreStages(design, entry);
+        restoreLayout(design, entry);
+    }
+
+    static void restoreLayout(PoleFilterBase2& design, const Entry& entry)
+    {
+        design.setDigitalLayout(entry.poleZeros);
+    }
+
+    // other designs have no layout besides their coefficients
+    static void restoreLayout(Cascade&, const Entry&)
+    {
+    }
+
+    static void restoreLayout(BiquadBase&, const Entry&)
+    {
+    }
+
+    mutable std::mutex m_mutex;
+    int m_capacity;
+    List m_list;
+    std::map<Key, List::iterator> m_index;
+    Stats m_stats;
+};
+
+}
+
+#endif
@@ -198,7 +198,8 @@ class SmoothedFilterDesign : public Filter
   and also performs smoothing of parameters over time. Specifically, when
   one or more filter parameters (such as cutoff frequency) are changed, the
   class creates a transition over a given number of samples from the original
-  values to the new values. This process is invisible and seamless to the
+  coefficients to those of the new design, stepping each section's
+  coefficients once per sample. This process is invisible and seamless to the
   caller, except that the constructor takes an additional parameter that
   indicates the duration of transitions when parameters change.
 
@@ -44,11 +44,18 @@ THE SOFTWARE.
 
 #include "Biquad.h"
 #include "Cascade.h"
+#include "Denormal.h"
+#include "DesignCache.h"
 #include "Filter.h"
+#include "FilterBank.h"
+#include "ParallelCascade.h"
 #include "PoleFilter.h"
+#include "SegmentedFilter.h"
 #include "SmoothedFilter.h"
 #include "State.h"
 #include "Utilities.h"
+#include "VectorState.h"
+#include "ZeroPhaseFilter.h"
 
 #include "Bessel.h"
 #include "Butterworth.h"
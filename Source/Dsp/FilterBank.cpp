@@ -0,0 +1,330 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "FilterBank.h"
+#include "MathSupplement.h"
+#include "VectorSupport.h"
+
+namespace Dsp
+{
+
+namespace
+{
+
+enum
+{
+    stride = FilterBank::maxBands
+};
+
+// The kernels below take one tile of samples through the sections of every
+// band (one lane per band). y holds the tile as [sample][band], filled with
+// the input on entry and the band outputs on return. Per band and section
+// they compute
+//
+//   w   = x - a1*v1 - a2*v2 + offset
+//   out = b0*w + b1*v1 + b2*v2
+//
+// in the same order as DirectFormII::process1, with the offset of each
+// sample (offsets) on the first section and zeros on the others. Each
+// section runs over the whole tile at a time, so that its coefficients and
+// state stay in registers, for two groups of lanes at once where possible.
+//
+// coeffs is [stage][b0, b1, b2, a1, a2][band], v1 and v2 are [stage][band].
+
+void processBankScalar(double* y, int numSamples, int width, int numStages,
+                       const double* coeffs, double* v1, double* v2,
+                       const double* offsets, const double* zeros)
+{
+    for (int s = 0; s < numStages; ++s)
+    {
+        const double* off = s == 0 ? offsets : zeros;
+
+        for (int c = 0; c < width; ++c)
+        {
+            const double* k = coeffs + s * 5 * stride + c;
+            const double b0 = k[0], b1 = k[stride], b2 = k[2 * stride];
+            const double a1 = k[3 * stride], a2 = k[4 * stride];
+            double s1 = v1[s * stride + c];
+            double s2 = v2[s * stride + c];
+
+            double* io = y + c;
+            for (int n = 0; n < numSamples; ++n, io += stride)
+            {
+                const double w = *io - a1 * s1 - a2 * s2 + off[n];
+                *io = b0 * w + b1 * s1 + b2 * s2;
+                s2 = s1;
+                s1 = w;
+            }
+
+            v1[s * stride + c] = s1;
+            v2[s * stride + c] = s2;
+        }
+    }
+}
+
+#define DSP_BANK_KERNEL(name, target, Vec, lanes, mm)                           \
+target void name(double* y, int numSamples, int width, int numStages,           \
+                 const double* coeffs, double* v1, double* v2,                 \
+                 const double* offsets, const double* zeros)                   \
+{                                                                               \
+    for (int s = 0; s < numStages; ++s)                                         \
+    {                                                                           \
+        const double* off = s == 0 ? offsets : zeros;                           \
+        const double* k = coeffs + s * 5 * stride;                              \
+        double* p1 = v1 + s * stride;                                           \
+        double* p2 = v2 + s * stride;                                           \
+        int c = 0;                                                              \
+                                                                                \
+        for (; c + lanes < width; c += 2 * lanes)                               \
+        {                                                                       \
+            const int d = c + lanes;                                            \
+            const Vec b0a = mm##_loadu_pd(k + c);                               \
+            const Vec b1a = mm##_loadu_pd(k + stride + c);                      \
+            const Vec b2a = mm##_loadu_pd(k + 2 * stride + c);                  \
+            const Vec a1a = mm##_loadu_pd(k + 3 * stride + c);                  \
+            const Vec a2a = mm##_loadu_pd(k + 4 * stride + c);                  \
+            const Vec b0b = mm##_loadu_pd(k + d);                               \
+            const Vec b1b = mm##_loadu_pd(k + stride + d);                      \
+            const Vec b2b = mm##_loadu_pd(k + 2 * stride + d);                  \
+            const Vec a1b = mm##_loadu_pd(k + 3 * stride + d);                  \
+            const Vec a2b = mm##_loadu_pd(k + 4 * stride + d);                  \
+            Vec s1a = mm##_loadu_pd(p1 + c), s2a = mm##_loadu_pd(p2 + c);       \
+            Vec s1b = mm##_loadu_pd(p1 + d), s2b = mm##_loadu_pd(p2 + d);       \
+                                                                                \
+            double* io = y;                                                     \
+            for (int n = 0; n < numSamples; ++n, io += stride)                  \
+            {                                                                   \
+                const Vec o = mm##_set1_pd(off[n]);                             \
+                Vec wa = mm##_sub_pd(mm##_loadu_pd(io + c), mm##_mul_pd(a1a, s1a)); \
+                Vec wb = mm##_sub_pd(mm##_loadu_pd(io + d), mm##_mul_pd(a1b, s1b)); \
+                wa = mm##_add_pd(mm##_sub_pd(wa, mm##_mul_pd(a2a, s2a)), o);    \
+                wb = mm##_add_pd(mm##_sub_pd(wb, mm##_mul_pd(a2b, s2b)), o);    \
+                mm##_storeu_pd(io + c, mm##_add_pd(mm##_add_pd(                 \
+                    mm##_mul_pd(b0a, wa), mm##_mul_pd(b1a, s1a)),               \
+                    mm##_mul_pd(b2a, s2a)));                                    \
+                mm##_storeu_pd(io + d, mm##_add_pd(mm##_add_pd(                 \
+                    mm##_mul_pd(b0b, wb), mm##_mul_pd(b1b, s1b)),               \
+                    mm##_mul_pd(b2b, s2b)));                                    \
+                s2a = s1a;                                                      \
+                s1a = wa;                                                       \
+                s2b = s1b;                                                      \
+                s1b = wb;                                                       \
+            }                                                                   \
+                                                                                \
+            mm##_storeu_pd(p1 + c, s1a);                                        \
+            mm##_storeu_pd(p2 + c, s2a);                                        \
+            mm##_storeu_pd(p1 + d, s1b);                                        \
+            mm##_storeu_pd(p2 + d, s2b);                                        \
+        }                                                                       \
+                                                                                \
+        for (; c < width; c += lanes)                                           \
+        {                                                                       \
+            const Vec b0 = mm##_loadu_pd(k + c);                                \
+            const Vec b1 = mm##_loadu_pd(k + stride + c);                       \
+            const Vec b2 = mm##_loadu_pd(k + 2 * stride + c);                   \
+            const Vec a1 = mm##_loadu_pd(k + 3 * stride + c);                   \
+            const Vec a2 = mm##_loadu_pd(k + 4 * stride + c);                   \
+            Vec s1 = mm##_loadu_pd(p1 + c), s2 = mm##_loadu_pd(p2 + c);         \
+                                                                                \
+            double* io = y;                                                     \
+            for (int n = 0; n < numSamples; ++n, io += stride)                  \
+            {                                                                   \
+                Vec w = mm##_sub_pd(mm##_loadu_pd(io + c), mm##_mul_pd(a1, s1)); \
+                w = mm##_add_pd(mm##_sub_pd(w, mm##_mul_pd(a2, s2)),            \
+                                mm##_set1_pd(off[n]));                          \
+                mm##_storeu_pd(io + c, mm##_add_pd(mm##_add_pd(                 \
+                    mm##_mul_pd(b0, w), mm##_mul_pd(b1, s1)),                   \
+                    mm##_mul_pd(b2, s2)));                                      \
+                s2 = s1;                                                        \
+                s1 = w;                                                         \
+            }                                                                   \
+                                                                                \
+            mm##_storeu_pd(p1 + c, s1);                                         \
+            mm##_storeu_pd(p2 + c, s2);                                         \
+        }                                                                       \
+    }                                                                           \
+}
+
+#ifdef DSP_VECTOR_X86
+DSP_BANK_KERNEL(processBankSSE2, DSP_TARGET_SSE2, __m128d, 2, _mm)
+DSP_BANK_KERNEL(processBankAVX, DSP_TARGET_AVX, __m256d, 4, _mm256)
+#endif
+
+#ifdef DSP_VECTOR_AVX512
+DSP_BANK_KERNEL(processBankAVX512, DSP_TARGET_AVX512, __m512d, 8, _mm512)
+#endif
+
+}
+
+FilterBank::FilterBank()
+    : m_numBands(0)
+    , m_numStages(0)
+{
+    for (int band = 0; band < maxBands; ++band)
+        setIdentity(band);
+
+    reset();
+}
+
+void FilterBank::setNumBands(int numBands)
+{
+    numBands = std::min(std::max(numBands, 0), static_cast<int>(maxBands));
+
+    for (int band = m_numBands; band < numBands; ++band)
+        setIdentity(band);
+
+    m_numBands = numBands;
+}
+
+void FilterBank::setStage(int band, int stage,
+                          double b0, double b1, double b2,
+                          double a1, double a2)
+{
+    assert(band >= 0 && band < maxBands && stage >= 0 && stage < maxStages);
+
+    m_coeffs[stage][0][band] = b0;
+    m_coeffs[stage][1][band] = b1;
+    m_coeffs[stage][2][band] = b2;
+    m_coeffs[stage][3][band] = a1;
+    m_coeffs[stage][4][band] = a2;
+
+    m_numStages = std::max(m_numStages, stage + 1);
+}
+
+void FilterBank::setStage(int band, int stage, const BiquadBase& biquad)
+{
+    setStage(band, stage, biquad.m_b0, biquad.m_b1, biquad.m_b2, biquad.m_a1, biquad.m_a2);
+}
+
+void FilterBank::setBand(int band, Cascade& cascade)
+{
+    const int numStages = std::min(cascade.getNumStages(), static_cast<int>(maxStages));
+
+    for (int stage = 0; stage < maxStages; ++stage)
+    {
+        if (stage < numStages)
+            setStage(band, stage, cascade[stage]);
+        else
+            setStage(band, stage, 1, 0, 0, 0, 0);
+    }
+}
+
+void FilterBank::setGain(int band, double gain)
+{
+    assert(band >= 0 && band < maxBands);
+    m_gain[band] = gain;
+}
+
+void FilterBank::reset()
+{
+    for (int stage = 0; stage < maxStages; ++stage)
+    {
+        for (int band = 0; band < maxBands; ++band)
+            m_v1[stage][band] = m_v2[stage][band] = 0;
+    }
+
+    m_vsa = anti_denormal_vsa;
+}
+
+void FilterBank::setIdentity(int band)
+{
+    for (int stage = 0; stage < maxStages; ++stage)
+    {
+        m_coeffs[stage][0][band] = 1;
+        m_coeffs[stage][1][band] = 0;
+        m_coeffs[stage][2][band] = 0;
+        m_coeffs[stage][3][band] = 0;
+        m_coeffs[stage][4][band] = 0;
+        m_v1[stage][band] = m_v2[stage][band] = 0;
+    }
+
+    m_gain[band] = 0;
+}
+
+VectorInstructionSet FilterBank::getInstructionSet() const
+{
+    // the narrowest allowed instruction set that holds every band in one register
+    VectorInstructionSet instructionSet = getVectorInstructionSet();
+    while (instructionSet > vectorSSE2
+           && getVectorLanes(static_cast<VectorInstructionSet>(instructionSet - 1)) >= m_numBands)
+        instructionSet = static_cast<VectorInstructionSet>(instructionSet - 1);
+    return instructionSet;
+}
+
+void FilterBank::processTile(VectorInstructionSet instructionSet,
+                             const double* x, double* y, int numSamples)
+{
+    const int lanes = getVectorLanes(instructionSet);
+    const int width = (std::max(m_numBands, 1) + lanes - 1) / lanes * lanes;
+    const double* coeffs = &m_coeffs[0][0][0];
+    double* v1 = &m_v1[0][0];
+    double* v2 = &m_v2[0][0];
+
+    double offsets[tileLength];
+    double zeros[tileLength];
+    for (int n = 0; n < numSamples; ++n)
+    {
+        offsets[n] = m_vsa = -m_vsa;
+        zeros[n] = 0;
+
+        double* row = y + n * maxBands;
+        for (int c = 0; c < width; ++c)
+            row[c] = x[n];
+    }
+
+    switch (instructionSet)
+    {
+#ifdef DSP_VECTOR_X86
+        case vectorSSE2:
+            processBankSSE2(y, numSamples, width, m_numStages, coeffs, v1, v2, offsets, zeros);
+            break;
+        case vectorAVX:
+            processBankAVX(y, numSamples, width, m_numStages, coeffs, v1, v2, offsets, zeros);
+            break;
+#endif
+#ifdef DSP_VECTOR_AVX512
+        case vectorAVX512:
+            processBankAVX512(y, numSamples, width, m_numStages, coeffs, v1, v2, offsets, zeros);
+            break;
+#endif
+        default:
+            processBankScalar(y, numSamples, width, m_numStages, coeffs, v1, v2, offsets, zeros);
+            break;
+    }
+}
+
+}
@@ -0,0 +1,163 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_FILTERBANK_H
+#define DSPFILTERS_FILTERBANK_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "VectorState.h"
+
+#include <algorithm>
+
+namespace Dsp
+{
+
+/*
+ * A bank of filters sharing one input.
+ *
+ * Holds up to maxBands cascades of up to maxStages second order sections,
+ * each band with its own coefficients and gain, and runs one input stream
+ * through all of them at once: band k occupies lane k of the SIMD
+ * registers (see VectorInstructionSet), so extra bands cost little until
+ * the lanes run out. The output is the weighted sum of the bands.
+ *
+ * Each band computes exactly what a cascade of DirectFormII states would,
+ * with the anti-denormal offset on its first section only. Its output is
+ * rounded to the output sample type, multiplied by its gain and added to
+ * the sum in band order, in that type.
+ *
+ * Changing coefficients keeps the state, so bands can be retuned while
+ * running. Nothing allocates.
+ *
+ */
+class FilterBank
+{
+public:
+    enum
+    {
+        maxBands = 16,
+        maxStages = 4
+    };
+
+    FilterBank();
+
+    int getNumBands() const
+    {
+        return m_numBands;
+    }
+
+    // Bands that are added start from rest, passing their input through
+    // unchanged with a gain of zero, until they are set up.
+    void setNumBands(int numBands);
+
+    // Sets one section of one band. Sections that were never set pass their
+    // input through unchanged.
+    void setStage(int band, int stage,
+                  double b0, double b1, double b2,
+                  double a1, double a2);
+
+    void setStage(int band, int stage, const BiquadBase& biquad);
+
+    // Copies every section of a cascade (e.g. a Butterworth design) into one band.
+    void setBand(int band, Cascade& cascade);
+
+    void setGain(int band, double gain);
+
+    // Clears the state of every band.
+    void reset();
+
+    // Runs numSamples samples of in through every band and writes the weighted
+    // sum of the band outputs to sum. in and sum may be the same buffer.
+    template <typename InSample, typename OutSample>
+    void process(int numSamples, const InSample* in, OutSample* sum)
+    {
+        const VectorInstructionSet instructionSet = getInstructionSet();
+        const int numBands = m_numBands;
+
+        double x[tileLength];
+        double y[tileLength * maxBands];    // [sample][band]
+
+        for (int start = 0; start < numSamples; start += tileLength)
+        {
+            const int n = std::min(static_cast<int>(tileLength), numSamples - start);
+
+            for (int i = 0; i < n; ++i)
+                x[i] = in[start + i];
+
+            processTile(instructionSet, x, y, n);
+
+            const double* bands = y;
+            for (int i = 0; i < n; ++i, bands += maxBands)
+            {
+                OutSample total = 0;
+                for (int k = 0; k < numBands; ++k)
+                    total += static_cast<OutSample>(m_gain[k]) * static_cast<OutSample>(bands[k]);
+                sum[start + i] = total;
+            }
+        }
+    }
+
+private:
+    enum
+    {
+        tileLength = 64,    // samples per kernel call
+        numCoefficients = 5 // b0, b1, b2, a1, a2
+    };
+
+    VectorInstructionSet getInstructionSet() const;
+
+    void processTile(VectorInstructionSet instructionSet,
+                     const double* x, double* y, int numSamples);
+
+    void setIdentity(int band);
+
+    int m_numBands;
+    int m_numStages;        // sections run per band; the highest one set
+    double m_vsa;           // alternating anti-denormal offset
+
+    // coefficients and state, one row of bands per section
+    double m_coeffs[maxStages][numCoefficients][maxBands];
+    double m_v1[maxStages][maxBands];
+    double m_v2[maxStages][maxBands];
+
+    double m_gain[maxBands];
+};
+
+}
+
+#endif
@@ -0,0 +1,204 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "ParallelCascade.h"
+
+namespace Dsp
+{
+
+namespace
+{
+
+// b0 + b1 q + b2 q^2
+complex_t evaluate(const BiquadBase& stage, complex_t q)
+{
+    return stage.m_b0 + (stage.m_b1 + stage.m_b2 * q) * q;
+}
+
+int getNumZeros(const BiquadBase& stage)
+{
+    return stage.m_b2 != 0 ? 2 : (stage.m_b1 != 0 ? 1 : 0);
+}
+
+int getNumPoles(const BiquadBase& stage)
+{
+    return stage.m_a2 != 0 ? 2 : (stage.m_a1 != 0 ? 1 : 0);
+}
+
+}
+
+ParallelCascade::ParallelCascade()
+    : m_numSections(0)
+    , m_directGain(0)
+    , m_version(0)
+{
+}
+
+bool ParallelCascade::setup(Cascade& cascade)
+{
+    ++m_version;
+    m_numSections = 0;
+    m_directGain = 0;
+
+    const int numStages = cascade.getNumStages();
+
+    // the poles of each stage, 1 - p z^-1 being a factor of its denominator
+    complex_t poles[2 * maxSections];
+    int stageOfPole[2 * maxSections];
+    int numPoles = 0;
+    int numZeros = 0;
+    int numSections = 0;
+
+    for (int k = 0; k < numStages; ++k)
+    {
+        const BiquadBase& stage = cascade[k];
+        numZeros += getNumZeros(stage);
+
+        const int n = getNumPoles(stage);
+        if (n == 0)
+            continue;
+
+        if (numSections == maxSections)
+            return false;
+
+        if (n == 2)
+        {
+            // roots of z^2 + a1 z + a2
+            const complex_t root = std::sqrt(complex_t(stage.m_a1 * stage.m_a1 - 4 * stage.m_a2));
+            poles[numPoles] = (-stage.m_a1 + root) / 2.;
+            poles[numPoles + 1] = (-stage.m_a1 - root) / 2.;
+        }
+        else
+        {
+            poles[numPoles] = -stage.m_a1;
+        }
+
+        for (int i = 0; i < n; ++i)
+            stageOfPole[numPoles++] = numSections;
+
+        Biquad& section = m_sections[numSections++];
+        section.m_a0 = 1;
+        section.m_a1 = stage.m_a1;
+        section.m_a2 = stage.m_a2;
+        section.m_b0 = 0;
+        section.m_b1 = 0;
+        section.m_b2 = 0;
+    }
+
+    if (numZeros > numPoles)
+        return false;
+
+    for (int i = 0; i < numPoles; ++i)
+    {
+        for (int j = 0; j < i; ++j)
+        {
+            if (std::abs(poles[i] - poles[j]) <= 1e-12)
+                return false;
+        }
+    }
+
+    // residue of each pole: r_i = B(1/p_i) / prod_{j != i} (1 - p_j / p_i)
+    complex_t residues[2 * maxSections];
+    complex_t residueSum = 0;
+    for (int i = 0; i < numPoles; ++i)
+    {
+        const complex_t q = 1. / poles[i];
+
+        complex_t num = 1;
+        for (int k = 0; k < numStages; ++k)
+            num *= evaluate(cascade[k], q);
+
+        complex_t den = 1;
+        for (int j = 0; j < numPoles; ++j)
+        {
+            if (j != i)
+                den *= 1. - poles[j] * q;
+        }
+
+        residues[i] = num / den;
+        residueSum += residues[i];
+    }
+
+    // each section collects the terms r / (1 - p z^-1) of its poles
+    for (int i = 0; i < numPoles; ++i)
+    {
+        BiquadBase& section = m_sections[stageOfPole[i]];
+        section.m_b0 += residues[i].real();
+
+        // the other pole of the same section, if any
+        for (int j = 0; j < numPoles; ++j)
+        {
+            if (j != i && stageOfPole[j] == stageOfPole[i])
+                section.m_b1 -= (residues[i] * poles[j]).real();
+        }
+    }
+
+    // H at z^-1 = 0 is the product of the b0, and every section there gives its r
+    double b0 = 1;
+    for (int k = 0; k < numStages; ++k)
+        b0 *= cascade[k].m_b0;
+
+    m_directGain = b0 - residueSum.real();
+    m_numSections = numSections;
+    return true;
+}
+
+complex_t ParallelCascade::response(double normalizedFrequency) const
+{
+    complex_t h = m_directGain;
+    for (int i = 0; i < m_numSections; ++i)
+        h += m_sections[i].response(normalizedFrequency);
+    return h;
+}
+
+void ParallelCascade::update(State& state) const
+{
+    FilterBank& bank = state.m_bank;
+
+    bank.setNumBands(m_numSections);
+    for (int i = 0; i < m_numSections; ++i)
+    {
+        const BiquadBase& s = m_sections[i];
+        bank.setStage(i, 0, s.m_b0, s.m_b1, 0, s.m_a1, s.m_a2);
+        bank.setGain(i, 1);
+    }
+
+    state.m_source = this;
+    state.m_version = m_version;
+}
+
+}
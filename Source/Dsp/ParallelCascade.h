@@ -0,0 +1,189 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_PARALLELCASCADE_H
+#define DSPFILTERS_PARALLELCASCADE_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "FilterBank.h"
+
+namespace Dsp
+{
+
+/*
+ * A designed cascade, rewritten as a sum of sections.
+ *
+ * By partial fractions, a cascade of second order sections
+ *
+ *  H(z) = prod B_k(z) / A_k(z)
+ *
+ * equals a direct gain plus a sum of sections with the same denominators,
+ *
+ *  H(z) = d + sum (c0_k + c1_k z^-1) / A_k(z)
+ *
+ * as long as its poles are distinct and it has no more zeros than poles,
+ * which holds for the Butterworth, Chebyshev, Elliptic, Bessel and Legendre
+ * designs. The sections no longer wait for each other, so they run side by
+ * side in the SIMD lanes of a FilterBank; a high order design then costs
+ * little more than a single section.
+ *
+ * Use it like a Cascade, with its own State:
+ *
+ *  Butterworth::Design::BandPass <8> design;
+ *  design.setParams (params);
+ *
+ *  ParallelCascade parallel;
+ *  parallel.setup (design);
+ *
+ *  ChannelsState <2, ParallelCascade::State> state;
+ *  state.process (numSamples, arrayOfChannels, parallel);
+ *
+ * The result matches the cascade to within rounding, which grows when
+ * poles lie close together (residues of nearby poles are large and cancel).
+ *
+ */
+class ParallelCascade
+{
+public:
+    enum
+    {
+        maxSections = FilterBank::maxBands
+    };
+
+    // The state of one channel
+    class State
+    {
+    public:
+        typedef State form_type;
+
+        State()
+            : m_source(0)
+            , m_version(0)
+        {
+        }
+
+        void reset()
+        {
+            m_bank.reset();
+        }
+
+        template <typename Sample>
+        inline Sample process(const Sample in, const ParallelCascade& p)
+        {
+            Sample out = in;
+            p.process(1, &out, *this);
+            return out;
+        }
+
+    private:
+        friend class ParallelCascade;
+
+        // the filter whose sections m_bank holds
+        const ParallelCascade* m_source;
+        int m_version;
+
+        FilterBank m_bank;
+    };
+
+    ParallelCascade();
+
+    // Works out the sections of a designed cascade. Returns false if it has
+    // no such expansion (repeated poles or more zeros than poles) or needs more
+    // than maxSections sections; the filter then passes nothing.
+    bool setup(Cascade& cascade);
+
+    int getNumSections() const
+    {
+        return m_numSections;
+    }
+
+    // The coefficients of a section; b2 is always zero.
+    const BiquadBase& getSection(int index) const
+    {
+        assert(index >= 0 && index < m_numSections);
+        return m_sections[index];
+    }
+
+    double getDirectGain() const
+    {
+        return m_directGain;
+    }
+
+    // Calculate filter response at the given normalized frequency.
+    complex_t response(double normalizedFrequency) const;
+
+    // Process a block of samples
+    template <typename Sample>
+    void process(int numSamples, Sample* dest, State& state) const
+    {
+        if (state.m_source != this || state.m_version != m_version)
+            update(state);
+
+        double sum[tileLength];
+
+        for (int start = 0; start < numSamples; start += tileLength)
+        {
+            const int n = std::min(static_cast<int>(tileLength), numSamples - start);
+            Sample* const x = dest + start;
+
+            state.m_bank.process(n, x, sum);
+
+            for (int i = 0; i < n; ++i)
+                x[i] = static_cast<Sample>(sum[i] + m_directGain * x[i]);
+        }
+    }
+
+private:
+    enum
+    {
+        tileLength = 64
+    };
+
+    // hands the sections over to a channel's bank, keeping its state
+    void update(State& state) const;
+
+    int m_numSections;
+    Biquad m_sections[maxSections];
+    double m_directGain;
+
+    int m_version;  // changes with every setup()
+};
+
+}
+
+#endif
@@ -80,6 +80,21 @@ public:
     }
 #endif
 
+    // Replaces the digital pole/zero layout, for designs whose coefficients
+    // are copied in rather than calculated (see DesignCache).
+    void setDigitalLayout(const std::vector<PoleZeroPair>& pairs)
+    {
+        assert(static_cast<int>(pairs.size()) <= (m_digitalProto.getMaxPoles() + 1) / 2);
+        m_digitalProto.reset();
+        for (size_t i = 0; i < pairs.size(); ++i)
+        {
+            if (pairs[i].isSinglePole())
+                m_digitalProto.add(pairs[i].poles.first, pairs[i].zeros.first);
+            else
+                m_digitalProto.add(pairs[i].poles, pairs[i].zeros);
+        }
+    }
+
 protected:
     LayoutBase m_digitalProto;
 };
@@ -0,0 +1,213 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "SegmentedFilter.h"
+#include "BlockStages.h"
+#include "Denormal.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace Dsp
+{
+
+namespace
+{
+
+enum
+{
+    tileLength = 256
+};
+
+// Filters a stretch of samples in place, starting from the state in v1 and
+// v2 and leaving the final state there.
+template <typename Sample>
+void filterSegment(const BiquadBase* stages, int numStages,
+                   double* v1, double* v2,
+                   Sample* samples, size_t numSamples)
+{
+    double x[tileLength];
+
+    for (size_t begin = 0; begin < numSamples; begin += tileLength)
+    {
+        const size_t n = std::min(static_cast<size_t>(tileLength), numSamples - begin);
+        Sample* const tile = samples + begin;
+
+        for (size_t i = 0; i < n; ++i)
+            x[i] = tile[i];
+
+        processStageBlock(stages, numStages, v1, v2, x, n);
+
+        for (size_t i = 0; i < n; ++i)
+            tile[i] = static_cast<Sample>(x[i]);
+    }
+}
+
+double getLargestState(int numStages, const double* v1, const double* v2)
+{
+    double largest = 0;
+    for (int k = 0; k < numStages; ++k)
+        largest = std::max(largest, std::max(std::abs(v1[k]), std::abs(v2[k])));
+    return largest;
+}
+
+// Adds the response of the stages with no input, from the state in v1 and
+// v2, to a stretch of samples, until it has died away. Returns false if it
+// lasts longer than the stretch; v1 and v2 then hold the state at its end.
+template <typename Sample>
+bool addFreeResponse(const BiquadBase* stages, int numStages,
+                     double* v1, double* v2,
+                     Sample* samples, size_t numSamples)
+{
+    const double limit = 1e-20 * getLargestState(numStages, v1, v2);
+    double x[tileLength];
+
+    for (size_t begin = 0; begin < numSamples; begin += tileLength)
+    {
+        if (getLargestState(numStages, v1, v2) <= limit)
+            return true;
+
+        const size_t n = std::min(static_cast<size_t>(tileLength), numSamples - begin);
+        Sample* const tile = samples + begin;
+
+        std::fill(x, x + n, 0.0);
+        processStageBlock(stages, numStages, v1, v2, x, n);
+
+        for (size_t i = 0; i < n; ++i)
+            tile[i] = static_cast<Sample>(tile[i] + x[i]);
+    }
+
+    return false;
+}
+
+template <typename Sample>
+void filterSegments(const std::vector<BiquadBase>& stageVector,
+                    int numThreads,
+                    size_t numSamples,
+                    Sample* samples)
+{
+    const int numStages = static_cast<int>(stageVector.size());
+    if (numSamples == 0 || numStages == 0)
+        return;
+
+    const BiquadBase* const stages = &stageVector[0];
+    const size_t maxSegments = std::max(numSamples / SegmentedFilter::minSegmentLength, static_cast<size_t>(1));
+    const int numSegments = static_cast<int>(std::min(static_cast<size_t>(numThreads), maxSegments));
+
+    std::vector<size_t> segmentStart(numSegments + 1);
+    for (int k = 0; k < numSegments; ++k)
+        segmentStart[k] = numSamples / numSegments * k;
+    segmentStart[numSegments] = numSamples;
+
+    // every segment from rest; afterwards the state each one ended in
+    std::vector<double> v1(static_cast<size_t>(numSegments) * numStages, 0.0);
+    std::vector<double> v2(v1.size(), 0.0);
+
+    std::atomic<int> nextSegment(0);
+    const auto filterNextSegments = [&]()
+    {
+        const ScopedFlushToZero flushToZero;
+
+        for (int k; (k = nextSegment++) < numSegments;)
+        {
+            filterSegment(stages, numStages, &v1[k * numStages], &v2[k * numStages],
+                          samples + segmentStart[k], segmentStart[k + 1] - segmentStart[k]);
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < numSegments; ++i)
+        threads.push_back(std::thread(filterNextSegments));
+
+    filterNextSegments();
+
+    for (size_t i = 0; i < threads.size(); ++i)
+        threads[i].join();
+
+    // Join the segments up in order. The state at the end of the first one
+    // is right; each following one is given the response to it and passes
+    // on its own final state, plus whatever is left of that response.
+    const ScopedFlushToZero flushToZero;
+    std::vector<double> s1(v1.begin(), v1.begin() + numStages);
+    std::vector<double> s2(v2.begin(), v2.begin() + numStages);
+
+    for (int k = 1; k < numSegments; ++k)
+    {
+        const bool diedAway = addFreeResponse(stages, numStages, &s1[0], &s2[0],
+                                              samples + segmentStart[k],
+                                              segmentStart[k + 1] - segmentStart[k]);
+
+        for (int i = 0; i < numStages; ++i)
+        {
+            s1[i] = v1[k * numStages + i] + (diedAway ? 0.0 : s1[i]);
+            s2[i] = v2[k * numStages + i] + (diedAway ? 0.0 : s2[i]);
+        }
+    }
+}
+
+}
+
+SegmentedFilter::SegmentedFilter()
+    : m_numThreads(0)
+{
+}
+
+void SegmentedFilter::setNumThreads(int numThreads)
+{
+    m_numThreads = std::max(numThreads, 0);
+}
+
+int SegmentedFilter::getNumThreads() const
+{
+    if (m_numThreads > 0)
+        return m_numThreads;
+
+    return std::max(static_cast<int>(std::thread::hardware_concurrency()), 1);
+}
+
+void SegmentedFilter::process(size_t numSamples, float* samples) const
+{
+    filterSegments(m_stages, getNumThreads(), numSamples, samples);
+}
+
+void SegmentedFilter::process(size_t numSamples, double* samples) const
+{
+    filterSegments(m_stages, getNumThreads(), numSamples, samples);
+}
+
+}
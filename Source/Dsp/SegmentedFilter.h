@@ -0,0 +1,122 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_SEGMENTEDFILTER_H
+#define DSPFILTERS_SEGMENTEDFILTER_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+
+#include <cstddef>
+
+namespace Dsp
+{
+
+/*
+ * Filtering of a long recording on several threads.
+ *
+ * A recursive filter is one long chain from the first sample to the last,
+ * so a long recording would keep a single core busy. This splits the signal
+ * into one segment per thread and filters all segments at once, each from
+ * rest. Then the segments are joined up: the filter is linear, so what a
+ * segment misses is the response to the state the previous segment ended in
+ * with no further input. That is added to its beginning, and the corrected
+ * final state is passed on to the next segment. The correction only runs
+ * until the response has died away (below 1e-20 of the state it started
+ * from), which for a stable filter is a short stretch compared with the
+ * segments, so this part hardly adds to the time.
+ *
+ *  Butterworth::Design::BandPass <2> design;
+ *  design.setParams (params);
+ *
+ *  SegmentedFilter filter;
+ *  filter.setup (design);
+ *  filter.process (numSamples, samples);
+ *
+ * The result is that of running the whole signal through the stages in one
+ * go, from rest, up to rounding. On one thread it is exactly what a Cascade
+ * with DirectFormII state and no denormal offset (see DenormalNone) gives.
+ * On more, the joins add rounding errors of their own, about as large as
+ * those the filter makes anyway: a 1-4 Hz band-pass at 30 kHz, whose
+ * Direct Form II sections lose the most, ends up 1.5e-8 of the amplitude
+ * away from the exact result instead of 1.4e-8; filters that are well
+ * conditioned stay within 1e-13. The signal is filtered in place, a tile at
+ * a time as in ZeroPhaseFilter, with denormals flushed to zero.
+ *
+ */
+class SegmentedFilter
+{
+public:
+    enum
+    {
+        minSegmentLength = 1 << 16  // shorter segments aren't worth a thread
+    };
+
+    SegmentedFilter();
+
+    // Copies the stages of a design (a Cascade or a single Biquad).
+    template <class DesignClass>
+    void setup(DesignClass& design)
+    {
+        const int numStages = getDesignNumStages(design);
+        m_stages.resize(numStages);
+        for (int i = 0; i < numStages; ++i)
+            m_stages[i] = getDesignStage(design, i);
+    }
+
+    int getNumStages() const
+    {
+        return static_cast<int>(m_stages.size());
+    }
+
+    // The number of threads to use, including the calling one; 0 (the
+    // default) for as many as the hardware runs at once.
+    void setNumThreads(int numThreads);
+    int getNumThreads() const;
+
+    // Filters numSamples samples in place, from rest.
+    void process(size_t numSamples, float* samples) const;
+    void process(size_t numSamples, double* samples) const;
+
+private:
+    std::vector<BiquadBase> m_stages;
+    int m_numThreads;
+};
+
+}
+
+#endif
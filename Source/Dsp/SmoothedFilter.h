@@ -39,6 +39,8 @@ THE SOFTWARE.
 #include <algorithm>
 
 #include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
 #include "Filter.h"
 
 namespace Dsp
@@ -47,6 +49,13 @@ namespace Dsp
 /*
  * Implements smooth modulation of time-varying filter parameters
  *
+ * When the parameters change, the coefficients of every section move in
+ * equal steps, one per sample, from the ones in use to those of the new
+ * design. This takes a few additions per sample instead of a new design.
+ * Each section's denominator stays inside the (convex) triangle of stable
+ * second order sections all the way, since both ends are. If the number of
+ * sections changes, the missing ones are taken as pass-through sections.
+ *
  */
 template <class DesignClass,
          int Channels,
@@ -75,23 +84,16 @@ public:
         // If this goes off it means setup() was never called
         assert(m_remainingSamples >= 0);
 
+        const typename DenormalPolicyOf<StateType>::type::Scope scope;
+
         // first handle any transition samples
         int remainingSamples = std::min(m_remainingSamples, numSamples);
 
         if (remainingSamples > 0)
         {
-            // interpolate parameters for each sample
-            const double t = 1. / m_remainingSamples;
-            double dp[maxParameters];
-            for (int i = 0; i < DesignClass::NumParams; ++i)
-                dp[i] = (this->getParams()[i] - m_transitionParams[i]) * t;
-
             for (int n = 0; n < remainingSamples; ++n)
             {
-                for (int i = DesignClass::NumParams; --i >=0;)
-                    m_transitionParams[i] += dp[i];
-
-                m_transitionFilter.setParams(m_transitionParams);
+                stepTransition();
 
                 for (int i = numChannels; --i >= 0;)
                 {
@@ -101,19 +103,19 @@ public:
             }
 
             m_remainingSamples -= remainingSamples;
-
-            if (m_remainingSamples == 0)
-                m_transitionParams = this->getParams();
         }
 
         // do what's left
         if (numSamples - remainingSamples > 0)
         {
-            // no transition
-            for (int i = 0; i < numChannels; ++i)
-                this->m_design.process(numSamples - remainingSamples,
-                                       destChannelArray[i] + remainingSamples,
-                                       this->m_state[i]);
+            // no transition; all channels go through the state's processor together.
+            // the state has exactly Channels channels, so fill in that many
+            assert(numChannels == Channels);
+            Sample* rest[Channels > 0 ? Channels : 1];
+            for (int i = 0; i < Channels; ++i)
+                rest[i] = destChannelArray[i] + remainingSamples;
+
+            this->m_state.process(numSamples - remainingSamples, rest, this->m_design);
         }
     }
 
@@ -130,23 +132,79 @@ public:
 protected:
     void doSetParams(const Params& parameters)
     {
-        if (m_remainingSamples >= 0)
-        {
-            m_remainingSamples = m_transitionSamples;
-        }
-        else
+        if (m_remainingSamples < 0)
         {
             // first time
             m_remainingSamples = 0;
-            m_transitionParams = parameters;
+            filter_type_t::doSetParams(parameters);
+            return;
+        }
+
+        // start from the coefficients in use: the current design's, or
+        // wherever an unfinished transition has got to
+        if (m_remainingSamples == 0)
+        {
+            const int numStages = getDesignNumStages(this->m_design);
+            setDesignNumStages(m_transitionFilter, numStages);
+            for (int i = 0; i < numStages; ++i)
+                getDesignStage(m_transitionFilter, i) = getDesignStage(this->m_design, i);
         }
 
         filter_type_t::doSetParams(parameters);
+
+        if (m_transitionSamples > 0)
+            beginTransition();
+        else
+            m_remainingSamples = 0;
+    }
+
+private:
+    // works out the per-sample coefficient steps from m_transitionFilter to m_design
+    void beginTransition()
+    {
+        const int numTo = getDesignNumStages(this->m_design);
+        const int numStages = std::max(getDesignNumStages(m_transitionFilter), numTo);
+        setDesignNumStages(m_transitionFilter, numStages);
+        setDesignNumStages(m_transitionStep, numStages);
+
+        Biquad identity;
+        identity.setIdentity();
+
+        const double t = 1. / m_transitionSamples;
+        for (int i = 0; i < numStages; ++i)
+        {
+            const BiquadBase& from = getDesignStage(m_transitionFilter, i);
+            const BiquadBase& to = i < numTo ? getDesignStage(this->m_design, i) : identity;
+            BiquadBase& step = getDesignStage(m_transitionStep, i);
+            step.m_a0 = (to.m_a0 - from.m_a0) * t;
+            step.m_a1 = (to.m_a1 - from.m_a1) * t;
+            step.m_a2 = (to.m_a2 - from.m_a2) * t;
+            step.m_b0 = (to.m_b0 - from.m_b0) * t;
+            step.m_b1 = (to.m_b1 - from.m_b1) * t;
+            step.m_b2 = (to.m_b2 - from.m_b2) * t;
+        }
+
+        m_remainingSamples = m_transitionSamples;
+    }
+
+    void stepTransition()
+    {
+        for (int i = getDesignNumStages(m_transitionFilter); --i >= 0;)
+        {
+            BiquadBase& stage = getDesignStage(m_transitionFilter, i);
+            const BiquadBase& step = getDesignStage(m_transitionStep, i);
+            stage.m_a0 += step.m_a0;
+            stage.m_a1 += step.m_a1;
+            stage.m_a2 += step.m_a2;
+            stage.m_b0 += step.m_b0;
+            stage.m_b1 += step.m_b1;
+            stage.m_b2 += step.m_b2;
+        }
     }
 
 protected:
-    Params m_transitionParams;
-    DesignClass m_transitionFilter;
+    DesignClass m_transitionFilter;  // the coefficients in use during a transition
+    DesignClass m_transitionStep;    // what is added to them for each sample
     int m_transitionSamples;
 
     int m_remainingSamples;        // remaining transition samples
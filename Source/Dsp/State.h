@@ -38,6 +38,7 @@ THE SOFTWARE.
 
 #include "Common.h"
 #include "Biquad.h"
+#include "Denormal.h"
 
 #include <stdexcept>
 
@@ -254,6 +255,262 @@ private:
 
 //------------------------------------------------------------------------------
 
+/*
+ * Reduced precision forms
+ *
+ * The forms above keep their state and do their arithmetic in double
+ * precision whatever the sample type. The forms below trade accuracy for
+ * half the state memory (and, where the arithmetic is single precision
+ * too, twice the SIMD width). They are used like any other form, through
+ * the StateType template parameter, e.g.
+ *
+ *  SimpleFilter <Butterworth::BandPass <2>, 4, DirectFormIMixed> f;
+ *
+ * How much accuracy is lost depends on the design far more than on the
+ * form. Coefficients are rounded to single precision (about 6e-8 relative)
+ * in the single precision forms, and a section with poles at angle w and
+ * radius r needs a1 = -2r cos(w) to resolve 1 - cos(w) ~ w^2/2, so poles
+ * close to z = 1 (low cutoffs at high sample rates) are moved or even made
+ * unstable. Rounding the recursive state adds noise that the section's
+ * resonance amplifies, roughly by 1 / (1 - r).
+ *
+ * Relative RMS error of the output against DirectFormII, for float
+ * samples through 2nd order Butterworth band-passes (two sections):
+ *
+ *                               1-4 Hz     1-4 Hz    13-18 Hz
+ *                               30 kHz     1 kHz     30 kHz
+ *  DirectFormI, TDFII           1e-8       2e-9      3e-9
+ *  DirectFormIMixed             5e-3       3e-5      1e-4
+ *  DirectFormIIMixed            1e-1       3e-5      3e-4
+ *  DirectFormIFloat             4e-2       4e-4      1e-2
+ *  TransposedDirectFormIIFloat  4e-2       4e-4      1e-2
+ *  DirectFormIIFloat            8e-1       1e-3      1e-2
+ *
+ * A lower sample rate for the same band (e.g. after decimating) is what
+ * makes the reduced precision forms usable.
+ *
+ */
+
+// Direct Form I with the input history in single precision and the output
+// history and the sums in double. Nothing is lost on the first section of
+// a cascade fed with float samples; later sections get double input, and
+// rounding their input history is what the error above comes from.
+class DirectFormIMixed
+{
+public:
+    DirectFormIMixed()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_x1 = 0;
+        m_x2 = 0;
+        m_y1 = 0;
+        m_y2 = 0;
+    }
+
+    template <typename Sample>
+    inline Sample process1(const Sample in,
+                           const BiquadBase& s,
+                           const double vsa)
+    {
+        double out = s.m_b0*in + s.m_b1*m_x1 + s.m_b2*m_x2
+                     - s.m_a1*m_y1 - s.m_a2*m_y2
+                     + vsa;
+        m_x2 = m_x1;
+        m_y2 = m_y1;
+        m_x1 = static_cast<float>(in);
+        m_y1 = out;
+
+        return static_cast<Sample>(out);
+    }
+
+protected:
+    float m_x2; // x[n-2]
+    float m_x1; // x[n-1]
+    double m_y2; // y[n-2]
+    double m_y1; // y[n-1]
+};
+
+// Direct Form II with the state stored in single precision and the
+// arithmetic done in double.
+class DirectFormIIMixed
+{
+public:
+    DirectFormIIMixed()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_v1 = 0;
+        m_v2 = 0;
+    }
+
+    template <typename Sample>
+    Sample process1(const Sample in,
+                    const BiquadBase& s,
+                    const double vsa)
+    {
+        double w   = in - s.m_a1*m_v1 - s.m_a2*m_v2 + vsa;
+        double out =      s.m_b0*w    + s.m_b1*m_v1 + s.m_b2*m_v2;
+
+        m_v2 = m_v1;
+        m_v1 = static_cast<float>(w);
+
+        return static_cast<Sample>(out);
+    }
+
+private:
+    float m_v1; // v[-1]
+    float m_v2; // v[-2]
+};
+
+// Direct Form I entirely in single precision
+class DirectFormIFloat
+{
+public:
+    DirectFormIFloat()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_x1 = 0;
+        m_x2 = 0;
+        m_y1 = 0;
+        m_y2 = 0;
+    }
+
+    template <typename Sample>
+    inline Sample process1(const Sample in,
+                           const BiquadBase& s,
+                           const double vsa)
+    {
+        const float x = static_cast<float>(in);
+        float out = static_cast<float>(s.m_b0)*x
+                    + static_cast<float>(s.m_b1)*m_x1
+                    + static_cast<float>(s.m_b2)*m_x2
+                    - static_cast<float>(s.m_a1)*m_y1
+                    - static_cast<float>(s.m_a2)*m_y2
+                    + static_cast<float>(vsa);
+        m_x2 = m_x1;
+        m_y2 = m_y1;
+        m_x1 = x;
+        m_y1 = out;
+
+        return static_cast<Sample>(out);
+    }
+
+protected:
+    float m_x2; // x[n-2]
+    float m_y2; // y[n-2]
+    float m_x1; // x[n-1]
+    float m_y1; // y[n-1]
+};
+
+// Direct Form II entirely in single precision
+class DirectFormIIFloat
+{
+public:
+    DirectFormIIFloat()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_v1 = 0;
+        m_v2 = 0;
+    }
+
+    template <typename Sample>
+    Sample process1(const Sample in,
+                    const BiquadBase& s,
+                    const double vsa)
+    {
+        float w   = static_cast<float>(in)
+                    - static_cast<float>(s.m_a1)*m_v1
+                    - static_cast<float>(s.m_a2)*m_v2
+                    + static_cast<float>(vsa);
+        float out = static_cast<float>(s.m_b0)*w
+                    + static_cast<float>(s.m_b1)*m_v1
+                    + static_cast<float>(s.m_b2)*m_v2;
+
+        m_v2 = m_v1;
+        m_v1 = w;
+
+        return static_cast<Sample>(out);
+    }
+
+private:
+    float m_v1; // v[-1]
+    float m_v2; // v[-2]
+};
+
+// Transposed Direct Form II entirely in single precision
+class TransposedDirectFormIIFloat
+{
+public:
+    TransposedDirectFormIIFloat()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_s1 = 0;
+        m_s2 = 0;
+    }
+
+    template <typename Sample>
+    inline Sample process1(const Sample in,
+                           const BiquadBase& s,
+                           const double vsa)
+    {
+        const float x = static_cast<float>(in);
+        float out = m_s1 + static_cast<float>(s.m_b0)*x + static_cast<float>(vsa);
+        m_s1 = m_s2 + static_cast<float>(s.m_b1)*x - static_cast<float>(s.m_a1)*out;
+        m_s2 = static_cast<float>(s.m_b2)*x - static_cast<float>(s.m_a2)*out;
+
+        return static_cast<Sample>(out);
+    }
+
+private:
+    float m_s1;
+    float m_s2;
+};
+
+//------------------------------------------------------------------------------
+
+// Runs the channels of a ChannelsState through a filter. By default each
+// channel is processed separately; a state form can specialize this to
+// process them together (see DirectFormIIVector).
+template <class FormType>
+struct ChannelsProcessor
+{
+    template <class Filter, class StateType, int Channels, typename Sample>
+    static void process(int numSamples,
+                        Sample* const* arrayOfChannels,
+                        Filter& filter,
+                        StateType (&state)[Channels])
+    {
+        for (int i = 0; i < Channels; ++i)
+            filter.process(numSamples, arrayOfChannels[i], state[i]);
+    }
+};
+
+// A form with a denormal policy is processed like the form itself
+template <class FormType, class DenormalPolicy>
+struct ChannelsProcessor <DenormalForm <FormType, DenormalPolicy> >
+    : ChannelsProcessor <FormType>
+{
+};
+
 // Holds an array of states suitable for multi-channel processing
 template <int Channels, class StateType>
 class ChannelsState
@@ -285,8 +542,11 @@ public:
                  Sample* const* arrayOfChannels,
                  Filter& filter)
     {
-        for (int i = 0; i < Channels; ++i)
-            filter.process(numSamples, arrayOfChannels[i], m_state[i]);
+        typedef typename StateType::form_type Form;
+        const typename DenormalPolicyOf<Form>::type::Scope scope;
+
+        ChannelsProcessor <Form>::process(
+            numSamples, arrayOfChannels, filter, m_state);
     }
 
 private:
@@ -0,0 +1,252 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+#include "Common.h"
+#include "VectorState.h"
+#include "VectorSupport.h"
+
+namespace Dsp
+{
+
+namespace
+{
+
+// The section loops below all compute, per channel,
+//
+//   w   = x - a1*v1 - a2*v2 + offset
+//   out = b0*w + b1*v1 + b2*v2
+//
+// in the same order as DirectFormII::process1.
+
+void processSectionScalar(double* frames, int numFrames, int width,
+                          const BiquadBase& s, double* v1, double* v2,
+                          const double* offsets)
+{
+    for (int n = 0; n < numFrames; ++n, frames += width)
+    {
+        const double offset = offsets ? offsets[n] : 0;
+        for (int c = 0; c < width; ++c)
+        {
+            const double s1 = v1[c];
+            const double s2 = v2[c];
+            const double w = frames[c] - s.m_a1*s1 - s.m_a2*s2 + offset;
+            frames[c] = s.m_b0*w + s.m_b1*s1 + s.m_b2*s2;
+            v2[c] = s1;
+            v1[c] = w;
+        }
+    }
+}
+
+// One section with one instruction set. Each group of channels keeps its
+// state in registers while it steps through the frames, two groups at a
+// time so that two recursions are in flight.
+#define DSP_VECTOR_SECTION(name, target, Vec, lanes, mm)                        \
+target void name(double* frames, int numFrames, int width,                      \
+                 const BiquadBase& s, double* v1, double* v2,                   \
+                 const double* offsets)                                         \
+{                                                                               \
+    const Vec b0 = mm##_set1_pd(s.m_b0);                                        \
+    const Vec b1 = mm##_set1_pd(s.m_b1);                                        \
+    const Vec b2 = mm##_set1_pd(s.m_b2);                                        \
+    const Vec a1 = mm##_set1_pd(s.m_a1);                                        \
+    const Vec a2 = mm##_set1_pd(s.m_a2);                                        \
+    const Vec zero = mm##_setzero_pd();                                         \
+                                                                                \
+    for (int c = 0; c < width; c += 2 * lanes)                                  \
+    {                                                                           \
+        const bool pair = c + 2 * lanes <= width;                               \
+        const int d = pair ? c + lanes : c;                                     \
+        Vec s1a = mm##_loadu_pd(v1 + c), s2a = mm##_loadu_pd(v2 + c);           \
+        Vec s1b = mm##_loadu_pd(v1 + d), s2b = mm##_loadu_pd(v2 + d);           \
+        double* f = frames;                                                     \
+                                                                                \
+        for (int n = 0; n < numFrames; ++n, f += width)                         \
+        {                                                                       \
+            const Vec offset = offsets ? mm##_set1_pd(offsets[n]) : zero;       \
+            const Vec wa = mm##_add_pd(mm##_sub_pd(mm##_sub_pd(                 \
+                mm##_loadu_pd(f + c), mm##_mul_pd(a1, s1a)),                    \
+                mm##_mul_pd(a2, s2a)), offset);                                 \
+            const Vec wb = mm##_add_pd(mm##_sub_pd(mm##_sub_pd(                 \
+                mm##_loadu_pd(f + d), mm##_mul_pd(a1, s1b)),                    \
+                mm##_mul_pd(a2, s2b)), offset);                                 \
+            const Vec ya = mm##_add_pd(mm##_add_pd(mm##_mul_pd(b0, wa),         \
+                mm##_mul_pd(b1, s1a)), mm##_mul_pd(b2, s2a));                   \
+            const Vec yb = mm##_add_pd(mm##_add_pd(mm##_mul_pd(b0, wb),         \
+                mm##_mul_pd(b1, s1b)), mm##_mul_pd(b2, s2b));                   \
+            /* without a pair, both groups are the same one; b is stored first */ \
+            mm##_storeu_pd(f + d, yb);                                          \
+            mm##_storeu_pd(f + c, ya);                                          \
+            s2a = s1a; s1a = wa;                                                \
+            s2b = s1b; s1b = wb;                                                \
+        }                                                                       \
+                                                                                \
+        mm##_storeu_pd(v1 + d, s1b); mm##_storeu_pd(v2 + d, s2b);               \
+        mm##_storeu_pd(v1 + c, s1a); mm##_storeu_pd(v2 + c, s2a);               \
+    }                                                                           \
+}
+
+#ifdef DSP_VECTOR_X86
+DSP_VECTOR_SECTION(processSectionSSE2, DSP_TARGET_SSE2, __m128d, 2, _mm)
+DSP_VECTOR_SECTION(processSectionAVX, DSP_TARGET_AVX, __m256d, 4, _mm256)
+#endif
+
+#ifdef DSP_VECTOR_AVX512
+DSP_VECTOR_SECTION(processSectionAVX512, DSP_TARGET_AVX512, __m512d, 8, _mm512)
+#endif
+
+VectorInstructionSet detectVectorInstructionSet()
+{
+#if defined(DSP_VECTOR_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    const bool sse2 = (info[3] & (1 << 26)) != 0;
+    const bool osxsave = (info[2] & (1 << 27)) != 0;
+    const bool avx = (info[2] & (1 << 28)) != 0;
+
+    // the OS must save the AVX (and AVX-512) registers too
+    const unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    const bool avxState = (xcr0 & 0x06) == 0x06;
+    const bool avx512State = (xcr0 & 0xe6) == 0xe6;
+
+    bool avx512 = false;
+    if (maxLeaf >= 7)
+    {
+        __cpuidex(info, 7, 0);
+        avx512 = (info[1] & (1 << 16)) != 0;
+    }
+
+#  ifdef DSP_VECTOR_AVX512
+    if (avx512 && avx512State)
+        return vectorAVX512;
+#  endif
+    if (avx && avxState)
+        return vectorAVX;
+    if (sse2)
+        return vectorSSE2;
+    return vectorScalar;
+
+#elif defined(DSP_VECTOR_X86)
+    // also checks that the OS saves the registers
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        return vectorAVX512;
+    if (__builtin_cpu_supports("avx"))
+        return vectorAVX;
+    if (__builtin_cpu_supports("sse2"))
+        return vectorSSE2;
+    return vectorScalar;
+
+#else
+    return vectorScalar;
+#endif
+}
+
+const VectorInstructionSet bestVectorInstructionSet = detectVectorInstructionSet();
+VectorInstructionSet vectorInstructionSet = bestVectorInstructionSet;
+
+}
+
+VectorInstructionSet getBestVectorInstructionSet()
+{
+    return bestVectorInstructionSet;
+}
+
+VectorInstructionSet getVectorInstructionSet()
+{
+    return vectorInstructionSet;
+}
+
+void setVectorInstructionSet(VectorInstructionSet instructionSet)
+{
+    vectorInstructionSet = std::min(instructionSet, bestVectorInstructionSet);
+}
+
+VectorInstructionSet getVectorInstructionSet(int numChannels)
+{
+    VectorInstructionSet instructionSet = vectorInstructionSet;
+    while (instructionSet > vectorSSE2 && getVectorLanes(instructionSet) > numChannels)
+        instructionSet = static_cast<VectorInstructionSet>(instructionSet - 1);
+    return instructionSet;
+}
+
+int getVectorLanes(VectorInstructionSet instructionSet)
+{
+    switch (instructionSet)
+    {
+        case vectorSSE2:
+            return 2;
+        case vectorAVX:
+            return 4;
+        case vectorAVX512:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+void processVectorSection(VectorInstructionSet instructionSet,
+                          double* frames,
+                          int numFrames,
+                          int width,
+                          const BiquadBase& section,
+                          double* v1,
+                          double* v2,
+                          const double* offsets)
+{
+    switch (instructionSet)
+    {
+#ifdef DSP_VECTOR_X86
+        case vectorSSE2:
+            processSectionSSE2(frames, numFrames, width, section, v1, v2, offsets);
+            break;
+        case vectorAVX:
+            processSectionAVX(frames, numFrames, width, section, v1, v2, offsets);
+            break;
+#endif
+#ifdef DSP_VECTOR_AVX512
+        case vectorAVX512:
+            processSectionAVX512(frames, numFrames, width, section, v1, v2, offsets);
+            break;
+#endif
+        default:
+            processSectionScalar(frames, numFrames, width, section, v1, v2, offsets);
+            break;
+    }
+}
+
+}
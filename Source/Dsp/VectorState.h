@@ -0,0 +1,276 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_VECTORSTATE_H
+#define DSPFILTERS_VECTORSTATE_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+#include "State.h"
+
+#include <algorithm>
+
+namespace Dsp
+{
+
+/*
+ * Direct Form II state for processing many channels at once.
+ *
+ * Use it as the StateType of a multi-channel FilterDesign, SimpleFilter
+ * or SmoothedFilterDesign, e.g.
+ *
+ *   SimpleFilter <Butterworth::BandPass <2>, 16, DirectFormIIVector> f;
+ *
+ * and the channels are run through each second order section together,
+ * a tile of samples at a time, with as many channels per instruction as
+ * the CPU allows (2 with SSE2, 4 with AVX, 8 with AVX-512, picked at run
+ * time). Every channel is computed with the same operations in the same
+ * order as DirectFormII, so the output is identical.
+ *
+ * Single samples (as during the transitions of a SmoothedFilterDesign)
+ * are processed one channel at a time, exactly like DirectFormII.
+ *
+ */
+class DirectFormIIVector
+{
+public:
+    DirectFormIIVector()
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        m_v1 = 0;
+        m_v2 = 0;
+    }
+
+    template <typename Sample>
+    Sample process1(const Sample in,
+                    const BiquadBase& s,
+                    const double vsa)
+    {
+        double w   = in - s.m_a1*m_v1 - s.m_a2*m_v2 + vsa;
+        double out =      s.m_b0*w    + s.m_b1*m_v1 + s.m_b2*m_v2;
+
+        m_v2 = m_v1;
+        m_v1 = w;
+
+        return static_cast<Sample>(out);
+    }
+
+private:
+    friend struct ChannelsProcessor <DirectFormIIVector>;
+
+    double m_v1; // v[-1]
+    double m_v2; // v[-2]
+};
+
+//------------------------------------------------------------------------------
+
+enum VectorInstructionSet
+{
+    vectorScalar,
+    vectorSSE2,
+    vectorAVX,
+    vectorAVX512
+};
+
+// The widest instruction set that both the CPU and this build support
+VectorInstructionSet getBestVectorInstructionSet();
+
+// The widest instruction set allowed, initially the best one. It can be
+// lowered, e.g. to compare speed; requests above the best are clamped.
+// Not to be changed while processing.
+VectorInstructionSet getVectorInstructionSet();
+void setVectorInstructionSet(VectorInstructionSet instructionSet);
+
+// The instruction set used for the given number of channels: the widest
+// allowed one whose registers they fill at least once
+VectorInstructionSet getVectorInstructionSet(int numChannels);
+
+// Number of channels processed per instruction
+int getVectorLanes(VectorInstructionSet instructionSet);
+
+// Runs numFrames frames of `width` channels (frames [frame * width + channel],
+// width a multiple of the instruction set's lanes) through one section in
+// place. v1 and v2 hold each channel's state. offsets, if not null, holds
+// the anti-denormal offset to add in each frame.
+void processVectorSection(VectorInstructionSet instructionSet,
+                          double* frames,
+                          int numFrames,
+                          int width,
+                          const BiquadBase& section,
+                          double* v1,
+                          double* v2,
+                          const double* offsets);
+
+inline int getVectorNumStages(Cascade& cascade)
+{
+    return cascade.getNumStages();
+}
+
+inline int getVectorNumStages(BiquadBase&)
+{
+    return 1;
+}
+
+inline const BiquadBase& getVectorStage(Cascade& cascade, int index)
+{
+    return cascade[index];
+}
+
+inline const BiquadBase& getVectorStage(BiquadBase& biquad, int)
+{
+    return biquad;
+}
+
+template <>
+struct ChannelsProcessor <DirectFormIIVector>
+{
+    enum
+    {
+        tileSize = 512,     // doubles of sample data per tile
+        minTileLength = 16, // samples per tile with many channels
+        maxTileSize = 4096  // doubles per tile at most (32 KB of stack); very many
+                            // channels get shorter tiles instead
+    };
+
+    template <class Filter, class StateType, int Channels, typename Sample>
+    static void process(int numSamples,
+                        Sample* const* arrayOfChannels,
+                        Filter& filter,
+                        StateType (&state)[Channels])
+    {
+        enum
+        {
+            maxWidth = (Channels + 7) / 8 * 8,
+            wanted = maxWidth * minTileLength > tileSize ? maxWidth * minTileLength : tileSize,
+            limited = wanted < maxTileSize ? wanted : maxTileSize,
+            capacity = limited > maxWidth ? limited : maxWidth,     // at least one frame
+
+            // the frames are never narrower than Channels, so no tile is longer than this
+            maxTileLength = capacity / (Channels > 1 ? Channels : 1)
+        };
+
+        // a single channel is faster on its own
+        if (Channels < 2)
+        {
+            ChannelsProcessor <DirectFormII>::process(numSamples, arrayOfChannels, filter, state);
+            return;
+        }
+
+        const VectorInstructionSet instructionSet = getVectorInstructionSet(Channels);
+        const int lanes = getVectorLanes(instructionSet);
+        const int width = std::min((Channels + lanes - 1) / lanes * lanes, static_cast<int>(maxWidth));
+        const int tileLength = capacity / width;
+        const int numStages = getVectorNumStages(filter);
+
+        double frames[capacity];
+        double offsets[maxTileLength];
+        double v1[maxWidth];
+        double v2[maxWidth];
+
+        for (int start = 0; start < numSamples; start += tileLength)
+        {
+            const int n = std::min(tileLength, numSamples - start);
+
+            // transpose the tile into frames of channels
+            for (int c = 0; c < width; ++c)
+            {
+                double* dest = frames + c;
+                if (c < Channels)
+                {
+                    const Sample* src = arrayOfChannels[c] + start;
+                    for (int i = 0; i < n; ++i, dest += width)
+                        *dest = src[i];
+                }
+                else
+                {
+                    for (int i = 0; i < n; ++i, dest += width)
+                        *dest = 0;
+                }
+            }
+
+            // every channel's offsets follow the same sequence, so the first one's serve all
+            for (int i = 0; i < n; ++i)
+                offsets[i] = state[0].nextDenormalOffset();
+
+            for (int stage = 0; stage < numStages; ++stage)
+            {
+                for (int c = 0; c < width; ++c)
+                {
+                    if (c < Channels)
+                    {
+                        const DirectFormIIVector& s = state[c].getStageState(stage);
+                        v1[c] = s.m_v1;
+                        v2[c] = s.m_v2;
+                    }
+                    else
+                    {
+                        v1[c] = v2[c] = 0;
+                    }
+                }
+
+                processVectorSection(instructionSet, frames, n, width, getVectorStage(filter, stage),
+                                     v1, v2, stage == 0 ? offsets : 0);
+
+                for (int c = 0; c < Channels; ++c)
+                {
+                    DirectFormIIVector& s = state[c].getStageState(stage);
+                    s.m_v1 = v1[c];
+                    s.m_v2 = v2[c];
+                }
+            }
+
+            for (int c = 0; c < Channels; ++c)
+            {
+                const double* src = frames + c;
+                Sample* dest = arrayOfChannels[c] + start;
+                for (int i = 0; i < n; ++i, src += width)
+                    dest[i] = static_cast<Sample>(*src);
+            }
+        }
+
+        for (int c = 1; c < Channels; ++c)
+            state[c].getDenormal().skip(numSamples);
+    }
+};
+
+}
+
+#endif
@@ -0,0 +1,71 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_VECTORSUPPORT_H
+#define DSPFILTERS_VECTORSUPPORT_H
+
+/*
+ * Compiler support for the SIMD kernels (VectorState.cpp, FilterBank.cpp).
+ * Only included by source files.
+ *
+ */
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#  define DSP_VECTOR_X86
+#  ifdef _MSC_VER
+#    include <intrin.h>     // __cpuid
+#  endif
+#  include <immintrin.h>
+// AVX-512 intrinsics need Visual Studio 2017 or later
+#  if !defined(_MSC_VER) || _MSC_VER >= 1910
+#    define DSP_VECTOR_AVX512
+#  endif
+#endif
+
+// GCC and Clang only allow the intrinsics of instruction sets enabled for the function.
+// Contraction into fused multiply-adds (part of AVX-512) is turned off, to keep the
+// results identical to the scalar code.
+#if defined(__GNUC__)
+#  define DSP_TARGET_SSE2 __attribute__((target("sse2")))
+#  define DSP_TARGET_AVX __attribute__((target("avx")))
+#  define DSP_TARGET_AVX512 __attribute__((target("avx512f"), optimize("fp-contract=off")))
+#else
+#  define DSP_TARGET_SSE2
+#  define DSP_TARGET_AVX
+#  define DSP_TARGET_AVX512
+#endif
+
+#endif
@@ -0,0 +1,197 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#include "Common.h"
+#include "ZeroPhaseFilter.h"
+#include "BlockStages.h"
+#include "Denormal.h"
+
+#include <algorithm>
+
+namespace Dsp
+{
+
+namespace
+{
+
+enum
+{
+    tileLength = 256
+};
+
+template <typename Sample>
+void filterForwardBackward(const std::vector<BiquadBase>& stages,
+                           const std::vector<double>& steadyState,
+                           size_t padLength,
+                           size_t numSamples,
+                           Sample* samples)
+{
+    const int numStages = static_cast<int>(stages.size());
+    if (numSamples == 0 || numStages == 0)
+        return;
+
+    const ScopedFlushToZero flushToZero;
+
+    // the point reflections of the signal about its end samples, outwards from them
+    const size_t pad = std::min(padLength, numSamples - 1);
+    const double first = samples[0];
+    const double last = samples[numSamples - 1];
+    std::vector<double> front(pad);
+    std::vector<double> back(pad);
+    for (size_t i = 0; i < pad; ++i)
+    {
+        front[i] = 2 * first - samples[i + 1];
+        back[i] = 2 * last - samples[numSamples - 2 - i];
+    }
+    std::reverse(front.begin(), front.end());
+
+    std::vector<double> v1(numStages);
+    std::vector<double> v2(numStages);
+    double x[tileLength];
+
+    // forwards, from the steady state for the first sample of the extended signal
+    const double start = pad > 0 ? front[0] : first;
+    for (int k = 0; k < numStages; ++k)
+        v1[k] = v2[k] = steadyState[k] * start;
+
+    processStageBlock(&stages[0], numStages, &v1[0], &v2[0], front.data(), pad);
+
+    for (size_t begin = 0; begin < numSamples; begin += tileLength)
+    {
+        const size_t n = std::min(static_cast<size_t>(tileLength), numSamples - begin);
+        Sample* const tile = samples + begin;
+
+        for (size_t i = 0; i < n; ++i)
+            x[i] = tile[i];
+
+        processStageBlock(&stages[0], numStages, &v1[0], &v2[0], x, n);
+
+        for (size_t i = 0; i < n; ++i)
+            tile[i] = static_cast<Sample>(x[i]);
+    }
+
+    processStageBlock(&stages[0], numStages, &v1[0], &v2[0], back.data(), pad);
+
+    // backwards, from the steady state for the last sample of the forward pass
+    const double end = pad > 0 ? back[pad - 1] : samples[numSamples - 1];
+    for (int k = 0; k < numStages; ++k)
+        v1[k] = v2[k] = steadyState[k] * end;
+
+    std::reverse(back.begin(), back.end());
+    processStageBlock(&stages[0], numStages, &v1[0], &v2[0], back.data(), pad);
+
+    for (size_t remaining = numSamples; remaining > 0;)
+    {
+        const size_t n = std::min(static_cast<size_t>(tileLength), remaining);
+        remaining -= n;
+        Sample* const tile = samples + remaining;
+
+        for (size_t i = 0; i < n; ++i)
+            x[i] = tile[n - 1 - i];
+
+        processStageBlock(&stages[0], numStages, &v1[0], &v2[0], x, n);
+
+        for (size_t i = 0; i < n; ++i)
+            tile[n - 1 - i] = static_cast<Sample>(x[i]);
+    }
+}
+
+}
+
+ZeroPhaseFilter::ZeroPhaseFilter()
+    : m_padLength(-1)
+{
+}
+
+void ZeroPhaseFilter::setPadLength(int padLength)
+{
+    m_padLength = padLength < 0 ? -1 : padLength;
+}
+
+int ZeroPhaseFilter::getPadLength() const
+{
+    if (m_padLength >= 0)
+        return m_padLength;
+
+    // as sosfiltfilt: sections without a b2 or an a2 make both polynomials shorter
+    int numWithoutB2 = 0;
+    int numWithoutA2 = 0;
+    for (size_t k = 0; k < m_stages.size(); ++k)
+    {
+        numWithoutB2 += m_stages[k].m_b2 == 0;
+        numWithoutA2 += m_stages[k].m_a2 == 0;
+    }
+
+    return 3 * (2 * getNumStages() + 1 - std::min(numWithoutB2, numWithoutA2));
+}
+
+complex_t ZeroPhaseFilter::response(double normalizedFrequency) const
+{
+    double magnitude = 1;
+    for (size_t k = 0; k < m_stages.size(); ++k)
+        magnitude *= std::norm(m_stages[k].response(normalizedFrequency));
+    return magnitude;
+}
+
+void ZeroPhaseFilter::process(size_t numSamples, float* samples) const
+{
+    filterForwardBackward(m_stages, m_steadyState, getPadLength(), numSamples, samples);
+}
+
+void ZeroPhaseFilter::process(size_t numSamples, double* samples) const
+{
+    filterForwardBackward(m_stages, m_steadyState, getPadLength(), numSamples, samples);
+}
+
+void ZeroPhaseFilter::updateSteadyState()
+{
+    // For a constant input u, a stage settles at v1 = v2 = u / (1 + a1 + a2)
+    // and puts out (b0 + b1 + b2) times that. A stage with a pole at 1 has no
+    // steady state; it and the stages after it start from rest.
+    m_steadyState.resize(m_stages.size());
+
+    double in = 1;
+    for (size_t k = 0; k < m_stages.size(); ++k)
+    {
+        const BiquadBase& s = m_stages[k];
+        const double den = 1 + s.m_a1 + s.m_a2;
+        const double v = den != 0 ? in / den : 0;
+        m_steadyState[k] = v;
+        in = (s.m_b0 + s.m_b1 + s.m_b2) * v;
+    }
+}
+
+}
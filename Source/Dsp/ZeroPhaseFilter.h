@@ -0,0 +1,125 @@
+/*******************************************************************************
+
+"A Collection of Useful C++ Classes for Digital Signal Processing"
+ By Vincent Falco
+
+Official project location:
+http://code.google.com/p/dspfilterscpp/
+
+See Documentation.cpp for contact information, notes, and bibliography.
+
+--------------------------------------------------------------------------------
+
+License: MIT License (http://www.opensource.org/licenses/mit-license.php)
+Copyright (c) 2009 by Vincent Falco
+
+Permission is hereby granted, free of charge, to any person obtaining a copy
+of this software and associated documentation files (the "Software"), to deal
+in the Software without restriction, including without limitation the rights
+to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+copies of the Software, and to permit persons to whom the Software is
+furnished to do so, subject to the following conditions:
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+THE SOFTWARE.
+
+*******************************************************************************/
+
+
+#ifndef DSPFILTERS_ZEROPHASEFILTER_H
+#define DSPFILTERS_ZEROPHASEFILTER_H
+
+#include "Common.h"
+#include "Biquad.h"
+#include "Cascade.h"
+
+#include <cstddef>
+
+namespace Dsp
+{
+
+/*
+ * Zero-phase filtering of a recorded signal.
+ *
+ * Runs a signal through a designed filter forwards and then backwards, like
+ * filtfilt in MATLAB and SciPy. The phase shifts of the two passes cancel, so
+ * features keep their place in time, and the magnitude response is that of
+ * the filter squared (twice the order, half the gain in dB at the edges).
+ * This only makes sense when the whole signal is at hand, i.e. offline.
+ *
+ * The edges are handled as in SciPy's sosfiltfilt: the signal is extended at
+ * both ends by its point reflection about the end sample, and each pass
+ * starts from the steady state of the filter for a constant input equal to
+ * its first sample, so that there is no start-up transient.
+ *
+ *  Butterworth::Design::BandPass <2> design;
+ *  design.setParams (params);
+ *
+ *  ZeroPhaseFilter filter;
+ *  filter.setup (design);
+ *  filter.process (numSamples, samples);
+ *
+ * The signal is filtered in place, a short tile at a time and one section
+ * at a time over each tile, so that it can be any size, memory-mapped for
+ * instance: apart from the padding nothing is copied. The sections work in
+ * double precision, but the result of the forward pass is stored in the
+ * sample type before the backward pass reads it back. Denormals are flushed
+ * to zero (see DenormalFlushToZero) rather than avoided with an offset.
+ *
+ */
+class ZeroPhaseFilter
+{
+public:
+    ZeroPhaseFilter();
+
+    // Copies the stages of a design (a Cascade or a single Biquad).
+    template <class DesignClass>
+    void setup(DesignClass& design)
+    {
+        const int numStages = getDesignNumStages(design);
+        m_stages.resize(numStages);
+        for (int i = 0; i < numStages; ++i)
+            m_stages[i] = getDesignStage(design, i);
+        updateSteadyState();
+    }
+
+    int getNumStages() const
+    {
+        return static_cast<int>(m_stages.size());
+    }
+
+    // Samples added at each end of the signal; by default (-1), as in SciPy,
+    // three times the number of coefficients in the filter's numerator or
+    // denominator, whichever is longer. Filters
+    // with a long decay (narrow or low bands) have smaller edge effects with
+    // longer padding. It is limited to one less than the signal's length.
+    void setPadLength(int padLength);
+    int getPadLength() const;
+
+    // Calculate filter response at the given normalized frequency; it is
+    // real and not negative.
+    complex_t response(double normalizedFrequency) const;
+
+    // Filters numSamples samples in place.
+    void process(size_t numSamples, float* samples) const;
+    void process(size_t numSamples, double* samples) const;
+
+private:
+    void updateSteadyState();
+
+    std::vector<BiquadBase> m_stages;
+    std::vector<double> m_steadyState;  // state of each stage for a constant input of 1
+    int m_padLength;
+};
+
+}
+
+#endif
@@ -0,0 +1,126 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "HalfbandDecimator.h"
+#include <algorithm> // fill, max
+#include <cmath>
+
+const double HalfbandDecimator::passband = 0.2;
+const double HalfbandDecimator::attenuationDb = 80.0;
+
+namespace
+{
+    // zeroth-order modified Bessel function of the first kind, for the Kaiser window
+    double besselI0(double x)
+    {
+        double sum = 1.0;
+        double term = 1.0;
+        for (int k = 1; k < 50; k++)
+        {
+            term *= (x / (2 * k)) * (x / (2 * k));
+            sum += term;
+            if (term < sum * 1e-17)
+                break;
+        }
+        return sum;
+    }
+}
+
+HalfbandDecimator::HalfbandDecimator()
+    : factor      (1)
+    , numChannels (1)
+{}
+
+void HalfbandDecimator::prepare(int newNumChannels, int newFactor)
+{
+    numChannels = std::max(newNumChannels, 1);
+
+    int numStages = 0;
+    while ((2 << numStages) <= newFactor)
+        numStages++;
+    factor = 1 << numStages;
+
+    stages.resize(numStages);
+    for (int s = 0; s < numStages; s++)
+    {
+        // At the input of stage s, the final passband edge is at passband * 2^s / factor of the rate.
+        // Everything that would alias onto it (above half the stage's output rate, minus the edge)
+        // has to be stopped, which leaves the rest of the band for the transition.
+        const double edge = passband * (1 << s) / factor;
+        designStage(stages[s], 0.5 - 2 * edge);
+
+        stages[s].history.assign(2 * static_cast<size_t>(stages[s].length) * numChannels, 0.0);
+    }
+
+    stageRows.assign(static_cast<size_t>(std::max(numStages - 1, 0)) * numChannels, 0.0);
+    reset();
+}
+
+void HalfbandDecimator::reset()
+{
+    for (Stage& stage : stages)
+    {
+        std::fill(stage.history.begin(), stage.history.end(), 0.0);
+        stage.writeIndex = 0;
+        stage.outputDue = false;
+    }
+}
+
+void HalfbandDecimator::designStage(Stage& stage, double transitionWidth)
+{
+    // Kaiser window design; transitionWidth is a fraction of the stage's input rate
+    const double a = attenuationDb;
+    const double beta = 0.1102 * (a - 8.7);
+    const int minLength = static_cast<int>(std::ceil((a - 7.95) / (14.36 * transitionWidth))) + 1;
+
+    // halfband filters with an odd number of nonzero side taps have a length of the form 4m + 3
+    int m = 0;
+    while (4 * m + 3 < minLength)
+        m++;
+
+    stage.length = 4 * m + 3;
+    const int center = (stage.length - 1) / 2;
+
+    // windowed sinc with its cutoff at a quarter of the rate; the taps at even distances from the
+    // center are exactly zero
+    const double pi = 3.14159265358979323846;
+    const double i0Beta = besselI0(beta);
+    stage.centerTap = 0.5;
+    stage.taps.resize(m + 1);
+
+    double dcGain = stage.centerTap;
+    for (int k = 0; k <= m; k++)
+    {
+        const int offset = 2 * k + 1;
+        const double r = static_cast<double>(offset) / center;
+        const double window = besselI0(beta * std::sqrt(1.0 - r * r)) / i0Beta;
+        const double sinc = std::sin(pi * offset / 2) / (pi * offset);
+        stage.taps[k] = sinc * window;
+        dcGain += 2 * stage.taps[k];
+    }
+
+    // unity gain at DC
+    stage.centerTap /= dcGain;
+    for (double& tap : stage.taps)
+        tap /= dcGain;
+}
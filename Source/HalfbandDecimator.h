@@ -0,0 +1,151 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Anti-aliased decimation by a power of two, as a cascade of halfband FIR stages that each halve the rate.
+// Each stage only has to keep aliases out of the final passband (0 to passband * the output rate),
+// so the early stages, which run at the highest rates, get by with very few taps; most of the
+// filtering is left to the last stage, which runs at twice the output rate. Halfband filters have
+// every other tap equal to zero and are symmetric, so each output costs about a quarter of a multiply
+// per tap.
+// Like MultiBandFilter, any number of channels are decimated together, with the history of each
+// stage stored [slot][channel] so that each output updates all channels with one loop over a row.
+
+#ifndef HALFBAND_DECIMATOR_H_INCLUDED
+#define HALFBAND_DECIMATOR_H_INCLUDED
+
+#include <cstddef> // size_t
+#include <vector>
+
+class HalfbandDecimator
+{
+public:
+    HalfbandDecimator();
+
+    // fraction of the output sample rate, from 0 Hz up, that is kept free of aliases
+    static const double passband;
+
+    // stopband attenuation of every stage (dB)
+    static const double attenuationDb;
+
+    // designs the stages for the given factor (rounded down to a power of two; 1 = pass through)
+    // and allocates and clears their history
+    void prepare(int newNumChannels, int newFactor);
+    int getFactor() const { return factor; }
+    int getNumChannels() const { return numChannels; }
+
+    void reset();
+
+    // Feeds one input frame (x[c] is channel c's sample). Every getFactor()-th call produces an output
+    // frame, which is written to y and true is returned; otherwise y is left alone and false is returned.
+    inline bool processFrame(const double* x, double* y);
+
+private:
+    struct Stage
+    {
+        int length;                 // number of taps, of the form 4m + 3
+        double centerTap;
+        std::vector<double> taps;   // nonzero taps on one side of the center, nearest first
+
+        std::vector<double> history;    // the last length inputs, stored twice in a row so that
+                                        // they can be read without wrapping, [slot][channel]
+        int writeIndex;
+        bool outputDue;
+    };
+
+    // advances one stage by one input frame; returns true if it produced an output frame in y
+    inline bool processStage(Stage& stage, const double* x, double* y);
+
+    static void designStage(Stage& stage, double transitionWidth);
+
+    int factor;
+    int numChannels;
+    std::vector<Stage> stages;
+    std::vector<double> stageRows;  // output row of each stage but the last, [stage][channel]
+};
+
+inline bool HalfbandDecimator::processStage(Stage& stage, const double* x, double* y)
+{
+    const int nChans = numChannels;
+    const int length = stage.length;
+
+    double* const slotA = &stage.history[static_cast<size_t>(stage.writeIndex) * nChans];
+    double* const slotB = slotA + static_cast<size_t>(length) * nChans;
+    for (int c = 0; c < nChans; c++)
+        slotA[c] = slotB[c] = x[c];
+
+    if (++stage.writeIndex == length)
+        stage.writeIndex = 0;
+
+    stage.outputDue = !stage.outputDue;
+    if (!stage.outputDue)
+        return false;
+
+    // the window, oldest first, starts at the slot that will be written next
+    const double* const window = &stage.history[static_cast<size_t>(stage.writeIndex) * nChans];
+    const int center = (length - 1) / 2;
+
+    const double* const mid = window + static_cast<size_t>(center) * nChans;
+    const double* const taps = stage.taps.data();
+    const int numTaps = static_cast<int>(stage.taps.size());
+
+    for (int c = 0; c < nChans; c++)
+        y[c] = stage.centerTap * mid[c];
+
+    // symmetric taps: each one is applied to the sum of the two inputs at the same distance from the center
+    for (int k = 0; k < numTaps; k++)
+    {
+        const double tap = taps[k];
+        const size_t offset = static_cast<size_t>(2 * k + 1) * nChans;
+        const double* const before = mid - offset;
+        const double* const after = mid + offset;
+
+        for (int c = 0; c < nChans; c++)
+            y[c] += tap * (before[c] + after[c]);
+    }
+
+    return true;
+}
+
+inline bool HalfbandDecimator::processFrame(const double* x, double* y)
+{
+    const int numStages = static_cast<int>(stages.size());
+    if (numStages == 0)
+    {
+        for (int c = 0; c < numChannels; c++)
+            y[c] = x[c];
+        return true;
+    }
+
+    const double* in = x;
+    for (int s = 0; s < numStages; s++)
+    {
+        double* const out = (s == numStages - 1) ? y : &stageRows[static_cast<size_t>(s) * numChannels];
+        if (!processStage(stages[s], in, out))
+            return false;
+        in = out;
+    }
+
+    return true;
+}
+
+#endif
@@ -0,0 +1,393 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "IntegratorEngine.h"
+#include <algorithm> // copy, max, min
+
+IntegratorEngine::IntegratorEngine()
+    : mode       (rollingMode)
+    , numStages  (CascadedLineLength::minStages)
+    , maxDecimatedWindowSize (1)
+    , statisticsEnabled (false)
+    , timer      (nullptr)
+    , outputGain (1.0f)
+    , sampleRate (0.0)
+    , windowSize (1)
+{
+    for (int w = 0; w < MultiWindowLineLength::maxWindows; w++)
+        extraWindowSizes[w] = 1;
+
+    setNumExtraWindows(0);
+    prepare(1, 1);
+}
+
+void IntegratorEngine::prepare(int newNumChannels, int maxWindowSize, int decimationFactor)
+{
+    decimator.prepare(newNumChannels, decimationFactor);
+    const int factor = decimator.getFactor();
+
+    bandFilter.setNumChannels(newNumChannels);
+    maxDecimatedWindowSize = std::max((maxWindowSize + factor - 1) / factor, 1);
+    prepareIntegrator();
+    if (statisticsEnabled)
+        statistics.prepare(newNumChannels, maxDecimatedWindowSize);
+    if (extraWindows.getNumWindows() > 0)
+        extraWindows.prepare(newNumChannels, maxDecimatedWindowSize, extraWindows.getNumWindows());
+
+    // carry the rate and window over to the new decimation factor
+    if (sampleRate > 0)
+        setSampleRate(sampleRate);
+    setWindowSize(windowSize);
+
+    const int nChans = bandFilter.getNumChannels();
+    inRow.assign(nChans, 0.0);
+    decimatedRow.assign(nChans, 0.0);
+    sumRow.assign(nChans, 0.0f);
+    meanRow.assign(nChans, 0.0f);
+    outRow.assign(nChans, 0.0f);
+    const Moments noMoments = {};
+    momentsRow.assign(nChans, noMoments);
+    extraRow.assign(static_cast<size_t>(MultiWindowLineLength::maxWindows) * nChans, 0.0f);
+    sumChunk.assign(nChans == 1 ? chunkLength : 0, 0.0f);
+}
+
+void IntegratorEngine::setSampleRate(double newSampleRate)
+{
+    sampleRate = newSampleRate;
+    bandFilter.setSampleRate(sampleRate / decimator.getFactor());
+}
+
+void IntegratorEngine::setWindowSize(int newWindowSize)
+{
+    windowSize = newWindowSize;
+
+    const int factor = decimator.getFactor();
+    const int decimatedSize = (newWindowSize + factor / 2) / factor;
+    rollingIntegrator.setWindowSize(decimatedSize);
+    exponentialIntegrator.setWindowSize(decimatedSize);
+    cascadedIntegrator.setWindowSize(decimatedSize);
+    statistics.setWindowSize(decimatedSize);
+
+    for (int w = 0; w < extraWindows.getNumWindows(); w++)
+        setExtraWindowSize(w, extraWindowSizes[w]);
+}
+
+void IntegratorEngine::setIntegratorMode(IntegratorMode newMode, int newNumStages)
+{
+    mode = newMode;
+    numStages = newNumStages;
+
+    prepareIntegrator();
+    setWindowSize(windowSize);
+}
+
+void IntegratorEngine::prepareIntegrator()
+{
+    const int nChans = getNumChannels();
+
+    // the kernels that aren't in use only take up a single sample
+    rollingIntegrator.prepare(nChans, mode == rollingMode ? maxDecimatedWindowSize : 1);
+    exponentialIntegrator.prepare(nChans);
+    cascadedIntegrator.prepare(nChans, mode == cascadedMode ? maxDecimatedWindowSize : 1, numStages);
+}
+
+void IntegratorEngine::setNumExtraWindows(int numWindows)
+{
+    // no windows only take up a single sample
+    if (numWindows > 0)
+        extraWindows.prepare(getNumChannels(), maxDecimatedWindowSize, numWindows);
+    else
+        extraWindows.prepare(1, 1, 0);
+
+    setWindowSize(windowSize);
+    extraWindows.beginBlock();
+}
+
+void IntegratorEngine::setExtraWindowSize(int window, int newWindowSize)
+{
+    if (window < 0 || window >= MultiWindowLineLength::maxWindows)
+        return;
+
+    extraWindowSizes[window] = newWindowSize;
+
+    const int factor = decimator.getFactor();
+    extraWindows.setWindowSize(window, (newWindowSize + factor / 2) / factor);
+}
+
+void IntegratorEngine::setStatisticsEnabled(bool enabled)
+{
+    statisticsEnabled = enabled;
+
+    // a disabled window only takes up a single sample
+    if (enabled)
+        statistics.prepare(getNumChannels(), maxDecimatedWindowSize);
+    else
+        statistics.prepare(1, 1);
+
+    setWindowSize(windowSize);
+    statistics.beginBlock();
+}
+
+void IntegratorEngine::reset()
+{
+    decimator.reset();
+    bandFilter.reset();
+    rollingIntegrator.reset();
+    exponentialIntegrator.reset();
+    cascadedIntegrator.reset();
+    statistics.reset();
+    extraWindows.reset();
+}
+
+void IntegratorEngine::process(const float* const* in, float* const* out, int nSamples,
+                               float* const* rawOut, float* const* sumOut, Moments* const* statsOut,
+                               float* const* const* windowOut)
+{
+    {
+        const ScopedStageTimer updateTimer(timer, ProcessTimer::updateStage);
+        bandFilter.beginBlock();
+        rollingIntegrator.beginBlock();
+        exponentialIntegrator.beginBlock();
+        cascadedIntegrator.beginBlock();
+        statistics.beginBlock();
+        extraWindows.beginBlock();
+    }
+
+    if (!statisticsEnabled)
+        statsOut = nullptr;
+    if (extraWindows.getNumWindows() == 0)
+        windowOut = nullptr;
+
+    const ScopedStageTimer kernelTimer(timer, ProcessTimer::kernelStage);
+    if (decimator.getFactor() == 1)
+        processFullRate(in, out, nSamples, rawOut, sumOut, statsOut, windowOut);
+    else
+        processDecimated(in, out, nSamples, rawOut, sumOut, statsOut, windowOut);
+}
+
+void IntegratorEngine::processFullRate(const float* const* in, float* const* out, int nSamples,
+                                       float* const* rawOut, float* const* sumOut, Moments* const* statsOut,
+                                       float* const* const* windowOut)
+{
+    const int nChans = getNumChannels();
+    if (nChans == 1)
+    {
+        processSingleChannel(in[0], out[0], nSamples,
+                             rawOut != nullptr ? rawOut[0] : nullptr,
+                             sumOut != nullptr ? sumOut[0] : nullptr,
+                             statsOut != nullptr ? statsOut[0] : nullptr,
+                             windowOut);
+        return;
+    }
+
+    double* const x = inRow.data();
+    float* const sum = sumRow.data();
+    float* const mean = meanRow.data();
+    Moments* const moments = momentsRow.data();
+    const float* const extra = extraRow.data();
+    const int nWindows = extraWindows.getNumWindows();
+    const float gain = outputGain;
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+        {
+            const float sample = in[c][i];
+            x[c] = sample;
+            if (rawOut != nullptr)
+                rawOut[c][i] = sample;
+        }
+
+        bandFilter.processFrame(x, sum);
+
+        if (sumOut != nullptr)
+        {
+            for (int c = 0; c < nChans; c++)
+                sumOut[c][i] = sum[c];
+        }
+
+        integrateFrame(sum, mean);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = gain * mean[c];
+
+        if (statisticsEnabled)
+        {
+            statistics.processFrame(sum, moments);
+
+            if (statsOut != nullptr)
+            {
+                for (int c = 0; c < nChans; c++)
+                    statsOut[c][i] = moments[c];
+            }
+        }
+
+        if (nWindows > 0)
+        {
+            processExtraWindows(sum, gain);
+
+            if (windowOut != nullptr)
+            {
+                for (int w = 0; w < nWindows; w++)
+                {
+                    for (int c = 0; c < nChans; c++)
+                        windowOut[w][c][i] = extra[w * nChans + c];
+                }
+            }
+        }
+    }
+}
+
+void IntegratorEngine::processDecimated(const float* const* in, float* const* out, int nSamples,
+                                        float* const* rawOut, float* const* sumOut, Moments* const* statsOut,
+                                        float* const* const* windowOut)
+{
+    const int nChans = getNumChannels();
+    double* const x = inRow.data();
+    double* const xDecimated = decimatedRow.data();
+    float* const sum = sumRow.data();
+    float* const mean = meanRow.data();
+    float* const held = outRow.data();
+    Moments* const moments = momentsRow.data();
+    const float* const extra = extraRow.data();
+    const int nWindows = extraWindows.getNumWindows();
+
+    // A band-limited signal's line length over a stretch of time hardly depends on the sample rate,
+    // but the mean difference per sample grows with the decimation factor. Scale it back so that
+    // the output matches the full-rate output.
+    const float gain = outputGain / decimator.getFactor();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+        {
+            const float sample = in[c][i];
+            x[c] = sample;
+            if (rawOut != nullptr)
+                rawOut[c][i] = sample;
+        }
+
+        if (decimator.processFrame(x, xDecimated))
+        {
+            bandFilter.processFrame(xDecimated, sum);
+            integrateFrame(sum, mean);
+
+            for (int c = 0; c < nChans; c++)
+                held[c] = gain * mean[c];
+
+            if (statisticsEnabled)
+                statistics.processFrame(sum, moments);
+            if (nWindows > 0)
+                processExtraWindows(sum, gain);
+        }
+
+        // sum, output, statistics and extra windows are held until the next decimated sample
+        if (sumOut != nullptr)
+        {
+            for (int c = 0; c < nChans; c++)
+                sumOut[c][i] = sum[c];
+        }
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = held[c];
+
+        if (statsOut != nullptr)
+        {
+            for (int c = 0; c < nChans; c++)
+                statsOut[c][i] = moments[c];
+        }
+
+        if (windowOut != nullptr)
+        {
+            for (int w = 0; w < nWindows; w++)
+            {
+                for (int c = 0; c < nChans; c++)
+                    windowOut[w][c][i] = extra[w * nChans + c];
+            }
+        }
+    }
+}
+
+void IntegratorEngine::processSingleChannel(const float* in, float* out, int nSamples,
+                                            float* rawOut, float* sumOut, Moments* statsOut,
+                                            float* const* const* windowOut)
+{
+    float* const sum = sumChunk.data();
+    const float gain = outputGain;
+    Moments moments;
+
+    for (int start = 0; start < nSamples; start += chunkLength)
+    {
+        const int n = std::min(static_cast<int>(chunkLength), nSamples - start);
+
+        if (rawOut != nullptr)
+            std::copy(in + start, in + start + n, rawOut + start);
+
+        // the whole chunk is read before any of its output is written, so in and out may still alias
+        bandFilter.processChannel(in + start, sum, n);
+
+        if (sumOut != nullptr)
+            std::copy(sum, sum + n, sumOut + start);
+
+        // one kernel for the whole chunk, so that its loop is as tight as a single kernel's
+        switch (mode)
+        {
+        case exponentialMode:
+            integrateChunk(exponentialIntegrator, sum, out + start, n, gain);
+            break;
+
+        case cascadedMode:
+            integrateChunk(cascadedIntegrator, sum, out + start, n, gain);
+            break;
+
+        default:
+            integrateChunk(rollingIntegrator, sum, out + start, n, gain);
+            break;
+        }
+
+        if (statisticsEnabled)
+        {
+            for (int i = 0; i < n; i++)
+            {
+                statistics.processFrame(sum + i, &moments);
+                if (statsOut != nullptr)
+                    statsOut[start + i] = moments;
+            }
+        }
+
+        const int nWindows = extraWindows.getNumWindows();
+        if (nWindows > 0)
+        {
+            const float* const extra = extraRow.data();
+            for (int i = 0; i < n; i++)
+            {
+                processExtraWindows(sum + i, gain);
+                if (windowOut != nullptr)
+                {
+                    for (int w = 0; w < nWindows; w++)
+                        windowOut[w][0][start + i] = extra[w];
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,219 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Complete multi-band integrator signal path as one fused kernel.
+// For each time step, every channel's input sample is read once and run through all band filters,
+// the weighted band sum, the absolute first difference and the rolling mean, and the scaled result is
+// written once. Per-channel values only live in small per-frame rows, so a block of any length
+// makes a single pass over the input and output buffers.
+// All working memory is allocated by prepare(). Nothing in process() depends on the block length,
+// so blocks of any size are handled without further allocation.
+// Optionally, the input is first decimated by a power of two (see HalfbandDecimator). The band filters
+// and the rolling window then run at the reduced rate, and each output is held for as many input
+// samples as went into it. The bands must lie within the decimator's passband.
+// A single channel at full rate is band filtered a chunk at a time instead (see
+// MultiBandFilter::processChannel), which gives the same result.
+// If enabled, rolling statistics of the weighted band sum over the same window (see RollingStatistics)
+// are computed along the way, at the filters' rate. Likewise, the same output can be computed over any
+// number of extra window lengths at once (see MultiWindowLineLength).
+// The main output's rolling mean can be swapped for an exponential average or a cascade of rolling
+// means over the same window length (see ExponentialLineLength and CascadedLineLength). Only the
+// kernel in use is given memory for the window.
+
+#ifndef INTEGRATOR_ENGINE_H_INCLUDED
+#define INTEGRATOR_ENGINE_H_INCLUDED
+
+#include "HalfbandDecimator.h"
+#include "MultiBandFilter.h"
+#include "ProcessTimer.h"
+#include "RollingIntegrator.h"
+#include "RollingStatistics.h"
+#include <vector>
+
+class IntegratorEngine
+{
+public:
+    // kernel that averages the absolute differences of the band sum into the output
+    enum IntegratorMode
+    {
+        rollingMode,        // mean over the window (RollingLineLength)
+        exponentialMode,    // single-pole average with the same mean age (ExponentialLineLength)
+        cascadedMode        // rolling means in a row, together as long as the window (CascadedLineLength)
+    };
+
+    IntegratorEngine();
+
+    // Allocates all working memory for the given number of channels, rolling windows of up to
+    // maxWindowSize input samples and decimation by decimationFactor (rounded down to a power of two;
+    // 1 = none), and clears all state. Must not be called while processing.
+    void prepare(int newNumChannels, int maxWindowSize, int decimationFactor = 1);
+    int getNumChannels() const { return bandFilter.getNumChannels(); }
+    int getDecimationFactor() const { return decimator.getFactor(); }
+
+    // the output is the rolling mean multiplied by this gain
+    void setOutputGain(float newGain) { outputGain = newGain; }
+
+    // input sample rate; the band filters are designed for the decimated rate
+    void setSampleRate(double newSampleRate);
+
+    // rolling window length in input samples; may be changed while processing, see RollingLineLength
+    void setWindowSize(int newWindowSize);
+
+    // Switches the output to another kernel; numStages is only used by cascadedMode. Allocates the
+    // kernel's window for the longest window size passed to prepare() and clears it. Kept across
+    // calls to prepare(); must not be called while processing.
+    void setIntegratorMode(IntegratorMode newMode, int newNumStages = CascadedLineLength::minStages);
+    IntegratorMode getIntegratorMode() const { return mode; }
+    int getNumStages() const { return cascadedIntegrator.getNumStages(); }
+
+    // Turns the rolling statistics of the band sum on or off. Allocates their window and clears it;
+    // must not be called while processing.
+    void setStatisticsEnabled(bool enabled);
+    bool getStatisticsEnabled() const { return statisticsEnabled; }
+
+    // Number of extra windows (up to MultiWindowLineLength::maxWindows, 0 = none) whose output is
+    // computed alongside the main one. Allocates their history and clears it; must not be called
+    // while processing.
+    void setNumExtraWindows(int numWindows);
+    int getNumExtraWindows() const { return extraWindows.getNumWindows(); }
+
+    // length of one extra window in input samples; may be changed while processing, like setWindowSize
+    void setExtraWindowSize(int window, int newWindowSize);
+
+    // The band table is configured directly on the band filter. Band changes take effect at the
+    // start of the first process() call after bandFilter.publish().
+    MultiBandFilter& getBandFilter() { return bandFilter; }
+
+    void reset();
+
+    // If set, process() records the time spent on picking up new settings and in the processing loop
+    // (only in builds with MBI_PROFILING, see ProcessTimer). Null for none.
+    void setTimer(ProcessTimer* newTimer) { timer = newTimer; }
+
+    // Processes getNumChannels() channels. in[c] and out[c] may point to the same buffer.
+    // If rawOut / sumOut are given, each channel's raw input and weighted band sum (before
+    // averaging) are also written there, for viewing alongside the output. If statsOut is given
+    // and the statistics are enabled, each channel's statistics are written there for every sample
+    // (held between decimated samples, like the output). If windowOut is given, windowOut[w][c]
+    // receives channel c's output over extra window w.
+    void process(const float* const* in, float* const* out, int nSamples,
+                 float* const* rawOut = nullptr, float* const* sumOut = nullptr,
+                 RollingStatistics::Moments* const* statsOut = nullptr,
+                 float* const* const* windowOut = nullptr);
+
+private:
+    typedef RollingStatistics::Moments Moments;
+
+    void processFullRate(const float* const* in, float* const* out, int nSamples,
+                         float* const* rawOut, float* const* sumOut, Moments* const* statsOut,
+                         float* const* const* windowOut);
+    void processDecimated(const float* const* in, float* const* out, int nSamples,
+                          float* const* rawOut, float* const* sumOut, Moments* const* statsOut,
+                          float* const* const* windowOut);
+    void processSingleChannel(const float* in, float* out, int nSamples,
+                              float* rawOut, float* sumOut, Moments* statsOut,
+                              float* const* const* windowOut);
+
+    // gives the kernel in use memory for the longest window, and the others as little as they can take
+    void prepareIntegrator();
+
+    // runs the kernel in use for one time step
+    inline void integrateFrame(const float* sum, float* mean);
+
+    // runs one channel's band sums through the given kernel and writes the scaled result
+    template <typename Integrator>
+    static void integrateChunk(Integrator& integrator, const float* sum, float* out, int nSamples, float gain)
+    {
+        float mean;
+        for (int i = 0; i < nSamples; i++)
+        {
+            integrator.processFrame(sum + i, &mean);
+            out[i] = gain * mean;
+        }
+    }
+
+    // runs the extra windows for one time step and fills extraRow with their scaled output
+    inline void processExtraWindows(const float* sum, float gain);
+
+    enum { chunkLength = 256 };     // samples per band filter call in processSingleChannel
+
+    HalfbandDecimator decimator;
+    MultiBandFilter bandFilter;
+    IntegratorMode mode;
+    int numStages;
+    int maxDecimatedWindowSize;     // longest window at the filters' rate
+    RollingLineLength rollingIntegrator;
+    ExponentialLineLength exponentialIntegrator;
+    CascadedLineLength cascadedIntegrator;
+    RollingStatistics statistics;   // only prepared for the channels and window while enabled
+    bool statisticsEnabled;
+    MultiWindowLineLength extraWindows;
+    int extraWindowSizes[MultiWindowLineLength::maxWindows];   // in input samples
+
+    ProcessTimer* timer;
+
+    float outputGain;
+    double sampleRate;
+    int windowSize;
+
+    // one value per channel for the current time step
+    std::vector<double> inRow;
+    std::vector<double> decimatedRow;
+    std::vector<float> sumRow;
+    std::vector<float> meanRow;
+    std::vector<float> outRow;      // output held between decimated samples
+    std::vector<Moments> momentsRow;    // statistics, likewise held
+    std::vector<float> extraRow;    // output over the extra windows, [window][channel], likewise held
+
+    std::vector<float> sumChunk;    // band sums of one chunk, single channel only
+};
+
+inline void IntegratorEngine::integrateFrame(const float* sum, float* mean)
+{
+    switch (mode)
+    {
+    case exponentialMode:
+        exponentialIntegrator.processFrame(sum, mean);
+        break;
+
+    case cascadedMode:
+        cascadedIntegrator.processFrame(sum, mean);
+        break;
+
+    default:
+        rollingIntegrator.processFrame(sum, mean);
+        break;
+    }
+}
+
+inline void IntegratorEngine::processExtraWindows(const float* sum, float gain)
+{
+    float* const means = extraRow.data();
+    extraWindows.processFrame(sum, means);
+
+    const int n = extraWindows.getNumWindows() * getNumChannels();
+    for (int k = 0; k < n; k++)
+        means[k] *= gain;
+}
+
+#endif
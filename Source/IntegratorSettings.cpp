@@ -0,0 +1,111 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "IntegratorSettings.h"
+#include <algorithm> // max, min
+
+const float IntegratorSettings::outputGain = 100.0f;
+
+IntegratorSettings::IntegratorSettings()
+    : rollDur          (1000)
+    , decimation       (1)
+    , integratorMode   (IntegratorEngine::rollingMode)
+    , cascadeStages    (CascadedLineLength::minStages)
+    , thresholdLevel   (0)
+    , thresholdHorizon (0)
+{
+    const FrequencyBand alpha = { 6.0f, 9.0f, 1.0f };     // fundamental
+    const FrequencyBand beta  = { 13.0f, 18.0f, 1.0f };   // harmonic
+    const FrequencyBand delta = { 1.0f, 4.0f, 1.0f };
+    bands.push_back(alpha);
+    bands.push_back(beta);
+    bands.push_back(delta);
+}
+
+int IntegratorSettings::getWindowSize(int sampleRate) const
+{
+    return static_cast<int>(sampleRate * rollDur / 1000);
+}
+
+int IntegratorSettings::getMaxWindowSize(int sampleRate) const
+{
+    return sampleRate * maxRollDur / 1000;
+}
+
+int IntegratorSettings::getDecimationFactor(int sampleRate) const
+{
+    float maxHigh = 0;
+    for (const FrequencyBand& b : bands)
+        maxHigh = std::max(maxHigh, b.high);
+
+    // halve the factor until the highest band edge is inside the passband of the decimated signal
+    int factor = decimation;
+    while (factor > 1 && maxHigh > getMaxBandFrequency(sampleRate, factor))
+        factor /= 2;
+
+    return std::max(factor, 1);
+}
+
+float IntegratorSettings::getMaxBandFrequency(int sampleRate, int decimationFactor)
+{
+    return static_cast<float>(HalfbandDecimator::passband * sampleRate / decimationFactor);
+}
+
+void IntegratorSettings::applyTo(IntegratorEngine& engine, int numChannels, int sampleRate) const
+{
+    engine.setIntegratorMode(integratorMode, cascadeStages);
+    engine.prepare(numChannels, getMaxWindowSize(sampleRate), getDecimationFactor(sampleRate));
+    engine.setNumExtraWindows(static_cast<int>(extraRollDurs.size()));
+    engine.setOutputGain(outputGain);
+    applyBands(engine, sampleRate);
+    applyWindow(engine, sampleRate);
+}
+
+void IntegratorSettings::applyBands(IntegratorEngine& engine, int sampleRate) const
+{
+    MultiBandFilter& bandFilter = engine.getBandFilter();
+    const int numBands = static_cast<int>(bands.size());
+
+    bandFilter.setNumBands(numBands);
+    engine.setSampleRate(sampleRate);
+
+    for (int n = 0; n < numBands; n++)
+        bandFilter.setBand(n, bands[n].low, bands[n].high, bands[n].gain);
+
+    bandFilter.publish();
+}
+
+void IntegratorSettings::applyWindow(IntegratorEngine& engine, int sampleRate) const
+{
+    engine.setWindowSize(getWindowSize(sampleRate));
+
+    for (int w = 0; w < engine.getNumExtraWindows(); w++)
+        engine.setExtraWindowSize(w, static_cast<int>(sampleRate * extraRollDurs[w] / 1000));
+}
+
+void IntegratorSettings::applyThreshold(AdaptiveThreshold& threshold, int sampleRate) const
+{
+    threshold.setLevel(std::min(std::max(thresholdLevel, 0.0f), 100.0f) / 100);
+    threshold.setHorizon(static_cast<int>(sampleRate * std::min(std::max(thresholdHorizon, 0.0f),
+                                                                static_cast<float>(maxThresholdHorizon))));
+}
@@ -0,0 +1,97 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// The settings that define the integrator's output, and how they are applied to an IntegratorEngine
+// (and to the AdaptiveThreshold that follows it).
+// The plugin and the offline tools both go through these functions, so that the same settings and
+// the same input samples always give exactly the same output, live or offline.
+
+#ifndef INTEGRATOR_SETTINGS_H_INCLUDED
+#define INTEGRATOR_SETTINGS_H_INCLUDED
+
+#include "AdaptiveThreshold.h"
+#include "IntegratorEngine.h"
+#include <vector>
+
+struct FrequencyBand
+{
+    float low;
+    float high;
+    float gain;
+};
+
+struct IntegratorSettings
+{
+    // plugin defaults: alpha, beta and delta bands, a one second window and no decimation
+    IntegratorSettings();
+
+    std::vector<FrequencyBand> bands;
+    float rollDur;      // rolling window duration (ms)
+    std::vector<float> extraRollDurs;   // durations of extra windows computed alongside (ms, none by default)
+    int decimation;     // decimation factor asked for (power of two, 1 = off)
+
+    IntegratorEngine::IntegratorMode integratorMode;    // kernel that averages over the window (rolling by default)
+    int cascadeStages;  // rolling means in a row in cascaded mode
+
+    float thresholdLevel;   // percentile of the output followed by the adaptive threshold (0 = no threshold)
+    float thresholdHorizon; // time over which the threshold forgets older output (s, 0 = whole session)
+
+    enum
+    {
+        maxBands = MultiBandFilter::maxBands,
+        maxRollDur = 10000,     // ms
+        maxDecimation = 256,
+        maxThresholdHorizon = 3600  // s
+    };
+
+    // scales the output so that its units are more useful
+    static const float outputGain;
+
+    // Sample rates are passed as whole numbers of Hz, since the plugin has always rounded them down
+    // before designing its filters and sizing its window.
+
+    int getWindowSize(int sampleRate) const;
+    int getMaxWindowSize(int sampleRate) const;
+
+    // largest power of two up to decimation that keeps every band within the decimator's passband
+    int getDecimationFactor(int sampleRate) const;
+
+    // highest band edge (Hz) that fits the decimator's passband at the given factor
+    static float getMaxBandFrequency(int sampleRate, int decimationFactor);
+
+    // prepares the engine for numChannels channels and applies all of the settings, including the kernel
+    void applyTo(IntegratorEngine& engine, int numChannels, int sampleRate) const;
+
+    // (re)designs and publishes the whole band table; the engine must already be prepared
+    void applyBands(IntegratorEngine& engine, int sampleRate) const;
+
+    // sets the rolling window length and those of the extra windows; the engine must already be prepared
+    void applyWindow(IntegratorEngine& engine, int sampleRate) const;
+
+    bool hasThreshold() const { return thresholdLevel > 0; }
+
+    // sets the threshold's level and horizon; may be called while processing
+    void applyThreshold(AdaptiveThreshold& threshold, int sampleRate) const;
+};
+
+#endif
@@ -0,0 +1,239 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "MultiBandFilter.h"
+#include "Dsp/Dsp.h" // filter design
+#include <algorithm>  // fill, min, max
+
+MultiBandFilter::Coefficients::Coefficients()
+    : numBands (0)
+{
+    const Section identity = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+    std::fill(sections, sections + maxBands * sectionsPerBand, identity);
+    std::fill(gains, gains + maxBands, 0.0f);
+}
+
+MultiBandFilter::MultiBandFilter()
+    : changed     (false)
+    , numBands    (0)
+    , sampleRate  (0.0)
+    , numChannels (0)
+    , vsa         (Dsp::anti_denormal_vsa)
+{
+    const Band silentBand = { 0.0f, 0.0f };
+    std::fill(bands, bands + maxBands, silentBand);
+    std::fill(needsDesign, needsDesign + maxBands, false);
+
+    current = &snapshots.getFront();
+    setNumChannels(1);
+}
+
+void MultiBandFilter::setSampleRate(double newSampleRate)
+{
+    if (newSampleRate == sampleRate)
+        return;
+
+    sampleRate = newSampleRate;
+    std::fill(needsDesign, needsDesign + numBands, true);
+    changed = true;
+}
+
+void MultiBandFilter::setNumBands(int newNumBands)
+{
+    newNumBands = std::min(std::max(newNumBands, 0), static_cast<int>(maxBands));
+
+    // existing bands keep their designs and state; new ones start out silent
+    const Band silentBand = { 0.0f, 0.0f };
+    const Section identity = { 1.0, 0.0, 0.0, 0.0, 0.0 };
+    for (int band = numBands; band < newNumBands; band++)
+    {
+        bands[band] = silentBand;
+        needsDesign[band] = false;
+        std::fill(staged.sections + band * sectionsPerBand,
+                  staged.sections + (band + 1) * sectionsPerBand, identity);
+        staged.gains[band] = 0.0f;
+    }
+
+    numBands = newNumBands;
+    staged.numBands = newNumBands;
+    changed = true;
+}
+
+void MultiBandFilter::setNumChannels(int newNumChannels)
+{
+    numChannels = newNumChannels < 1 ? 1 : newNumChannels;
+
+    const size_t stateSize = static_cast<size_t>(maxBands) * sectionsPerBand * numChannels;
+    v1.assign(stateSize, 0.0);
+    v2.assign(stateSize, 0.0);
+    inRow.assign(numChannels, 0.0);
+    bandRow.assign(numChannels, 0.0);
+    sumRow.assign(numChannels, 0.0f);
+    vsa = Dsp::anti_denormal_vsa;
+    bank.reset();
+}
+
+void MultiBandFilter::setBand(int band, float lowCut, float highCut, float gain)
+{
+    if (band < 0 || band >= numBands)
+        return;
+
+    if (bands[band].lowCut != lowCut || bands[band].highCut != highCut)
+    {
+        bands[band].lowCut = lowCut;
+        bands[band].highCut = highCut;
+        needsDesign[band] = true;
+    }
+
+    setGain(band, gain);
+    changed = true;
+}
+
+void MultiBandFilter::setGain(int band, float gain)
+{
+    if (band < 0 || band >= numBands)
+        return;
+
+    staged.gains[band] = gain;
+    changed = true;
+}
+
+void MultiBandFilter::publish()
+{
+    if (!changed)
+        return;
+
+    for (int band = 0; band < numBands; band++)
+    {
+        if (needsDesign[band])
+            designBand(band);
+    }
+
+    snapshots.getBack() = staged;
+    snapshots.publish();
+    changed = false;
+}
+
+void MultiBandFilter::reset()
+{
+    std::fill(v1.begin(), v1.end(), 0.0);
+    std::fill(v2.begin(), v2.end(), 0.0);
+    vsa = Dsp::anti_denormal_vsa;
+    bank.reset();
+}
+
+void MultiBandFilter::beginBlock()
+{
+    const int oldNumBands = current->numBands;
+
+    if (!snapshots.update())
+        return;
+
+    current = &snapshots.getFront();
+
+    // bands that were just added start from rest rather than from whatever a removed band left behind
+    if (current->numBands > oldNumBands)
+    {
+        const size_t begin = static_cast<size_t>(oldNumBands) * sectionsPerBand * numChannels;
+        const size_t end = static_cast<size_t>(current->numBands) * sectionsPerBand * numChannels;
+        std::fill(v1.begin() + begin, v1.begin() + end, 0.0);
+        std::fill(v2.begin() + begin, v2.begin() + end, 0.0);
+    }
+
+    // the bank clears the state of its new bands in the same way
+    bank.setNumBands(current->numBands);
+    const Section* s = current->sections;
+    for (int band = 0; band < current->numBands; band++)
+    {
+        for (int k = 0; k < sectionsPerBand; k++, s++)
+            bank.setStage(band, k, s->b0, s->b1, s->b2, s->a1, s->a2);
+
+        bank.setGain(band, current->gains[band]);
+    }
+}
+
+void MultiBandFilter::designBand(int band)
+{
+    needsDesign[band] = false;
+
+    if (sampleRate <= 0)
+        return;
+
+    const Band& b = bands[band];
+
+    Dsp::Params params;
+    params[0] = sampleRate;
+    params[1] = 2;                              // order
+    params[2] = (b.highCut + b.lowCut) / 2;     // center frequency
+    params[3] = b.highCut - b.lowCut;           // bandwidth
+
+    // bands are often set to edges they had before (presets, undo, several plugin instances)
+    Dsp::Butterworth::Design::BandPass<2> design;
+    Dsp::DesignCache::getShared().setParams(design, params);
+
+    // copy coefficients; the state is kept so that edits during acquisition don't click
+    Section* s = &staged.sections[band * sectionsPerBand];
+    for (int i = 0; i < sectionsPerBand; i++, s++)
+    {
+        if (i < design.getNumStages())
+        {
+            const Dsp::Cascade::Stage& stage = design[i];
+            s->b0 = stage.m_b0;
+            s->b1 = stage.m_b1;
+            s->b2 = stage.m_b2;
+            s->a1 = stage.m_a1;
+            s->a2 = stage.m_a2;
+        }
+        else
+        {
+            s->b0 = 1.0;
+            s->b1 = s->b2 = s->a1 = s->a2 = 0.0;
+        }
+    }
+}
+
+void MultiBandFilter::process(const float* const* in, float* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    double* const x = inRow.data();
+    float* const sum = sumRow.data();
+
+    beginBlock();
+
+    if (nChans == 1)
+    {
+        processChannel(in[0], out[0], nSamples);
+        return;
+    }
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, sum);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = sum[c];
+    }
+}
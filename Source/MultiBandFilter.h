@@ -0,0 +1,214 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Weighted sum of any number of band-pass filtered copies of one or more input signals.
+// Each band is a 2nd-order Butterworth band-pass (two biquad sections), designed with the Dsp library.
+// All bands are run in a single pass over the input and their weighted sum is accumulated directly,
+// without intermediate buffers.
+// Every channel shares the same coefficients. The filter state is stored structure-of-arrays,
+// one contiguous row of channels per section, so that each step in time updates all channels
+// with one loop over that row. A single channel has no row to loop over; it is run through a
+// Dsp::FilterBank instead, which puts the bands side by side in SIMD lanes. Both give the same result.
+//
+// Band settings are changed from a control thread (e.g. the message thread) while another thread
+// processes. The setters only edit a private copy of the band table; publish() designs the bands
+// whose edges changed and hands the new coefficients over to the processing thread, which switches
+// to them at the start of its next block. Several edits followed by one publish() reach the
+// processing thread together. Nothing on the processing side allocates or locks.
+
+#ifndef MULTIBAND_FILTER_H_INCLUDED
+#define MULTIBAND_FILTER_H_INCLUDED
+
+#include "TripleBuffer.h"
+#include "Dsp/FilterBank.h"
+#include <vector>
+
+class MultiBandFilter
+{
+public:
+    enum
+    {
+        sectionsPerBand = 2,
+        maxBands = 16
+    };
+
+    MultiBandFilter();
+
+    // ----- control thread -----
+
+    // redesigns every band for the new sample rate (on the next publish())
+    void setSampleRate(double newSampleRate);
+
+    // limited to maxBands; new bands pass nothing until they are set up with setBand
+    void setNumBands(int newNumBands);
+    int getNumBands() const { return numBands; }
+
+    // clears filter state; must not be called while processing
+    void setNumChannels(int newNumChannels);
+    int getNumChannels() const { return numChannels; }
+
+    // changes one band's edges and its weight in the sum; the band is redesigned on the next publish()
+    void setBand(int band, float lowCut, float highCut, float gain);
+    void setGain(int band, float gain);
+
+    // Designs the bands that changed since the last call and makes the result available to the
+    // processing thread. Does nothing if there were no changes.
+    void publish();
+
+    // clears filter state but keeps the designs; must not be called while processing
+    void reset();
+
+    // ----- processing thread -----
+
+    // switches to the most recently published coefficients; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; in[c] and out[c] may point to the same buffer
+    void process(const float* const* in, float* const* out, int nSamples);
+
+    // single-channel convenience, for use when getNumChannels() == 1
+    void process(const float* in, float* out, int nSamples)
+    {
+        process(&in, &out, nSamples);
+    }
+
+    // Runs nSamples samples of the only channel at once, for use when getNumChannels() == 1, after
+    // calling beginBlock(). Same result as calling processFrame() for each sample, but much faster.
+    // in and sum may point to the same buffer.
+    void processChannel(const float* in, float* sum, int nSamples)
+    {
+        bank.process(nSamples, in, sum);
+    }
+
+    // advances every channel by one sample: x[c] is channel c's input, sum[c] receives its weighted band sum.
+    // Defined inline so that fused kernels (see IntegratorEngine) can run it inside their own sample loop,
+    // after calling beginBlock().
+    inline void processFrame(const double* x, float* sum);
+
+private:
+    void designBand(int band);
+
+    struct Band
+    {
+        float lowCut;
+        float highCut;
+    };
+
+    // coefficients of one biquad section, Direct Form II
+    struct Section
+    {
+        double b0, b1, b2;
+        double a1, a2;
+    };
+
+    // everything processFrame needs to know about the bands, as one fixed-size snapshot
+    struct Coefficients
+    {
+        Coefficients();
+
+        int numBands;
+        Section sections[maxBands * sectionsPerBand];   // sectionsPerBand consecutive sections per band
+        float gains[maxBands];
+    };
+
+    // control thread: band edges, the coefficients being edited and which bands need a new design
+    Band bands[maxBands];
+    bool needsDesign[maxBands];
+    bool changed;
+    int numBands;
+    double sampleRate;
+    Coefficients staged;
+
+    TripleBuffer<Coefficients> snapshots;
+
+    // processing thread: the snapshot in use
+    const Coefficients* current;
+
+    // Direct Form II state, [section][channel], allocated for maxBands so that adding bands needs no memory
+    int numChannels;
+    std::vector<double> v1;
+    std::vector<double> v2;
+
+    // one value per channel for the current time step
+    std::vector<double> inRow;
+    std::vector<double> bandRow;
+    std::vector<float> sumRow;
+
+    double vsa;                     // alternating anti-denormal offset, as in Dsp::DenormalPrevention
+
+    // all bands of a single channel, in use when numChannels == 1; kept in step with the snapshot
+    Dsp::FilterBank bank;
+};
+
+inline void MultiBandFilter::processFrame(const double* x, float* sum)
+{
+    const Coefficients& coeffs = *current;
+    const int nBands = coeffs.numBands;
+    const int nChans = numChannels;
+    double* const y = bandRow.data();
+
+    if (nChans == 1)
+    {
+        bank.process(1, x, sum);
+        return;
+    }
+
+    vsa = -vsa;
+
+    for (int c = 0; c < nChans; c++)
+        sum[c] = 0.0f;
+
+    const Section* s = coeffs.sections;
+    double* sv1 = v1.data();
+    double* sv2 = v2.data();
+
+    for (int band = 0; band < nBands; band++)
+    {
+        for (int c = 0; c < nChans; c++)
+            y[c] = x[c];
+
+        for (int k = 0; k < sectionsPerBand; k++, s++, sv1 += nChans, sv2 += nChans)
+        {
+            // Direct Form II, with the anti-denormal offset on the first section only
+            const double b0 = s->b0, b1 = s->b1, b2 = s->b2;
+            const double a1 = s->a1, a2 = s->a2;
+            const double offset = (k == 0 ? vsa : 0.0);
+
+            for (int c = 0; c < nChans; c++)
+            {
+                const double w = y[c] - a1 * sv1[c] - a2 * sv2[c] + offset;
+                y[c] = b0 * w + b1 * sv1[c] + b2 * sv2[c];
+                sv2[c] = sv1[c];
+                sv1[c] = w;
+            }
+        }
+
+        // the weighted sum is accumulated in float, band by band,
+        // exactly as the per-band buffers used to be added together
+        const float gain = coeffs.gains[band];
+        for (int c = 0; c < nChans; c++)
+            sum[c] += gain * static_cast<float>(y[c]);
+    }
+}
+
+#endif
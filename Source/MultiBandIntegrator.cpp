@@ -27,32 +27,28 @@ First, simply filtering the data before thresholding
 
 #include "MultiBandIntegrator.h"
 #include "MultiBandIntegratorEditor.h"
-#include "boostAcc/boost/accumulators/accumulators.hpp"
-#include "boostAcc/boost/accumulators/statistics.hpp"
-#include "boostAcc/boost/accumulators/statistics/rolling_mean.hpp"
 
 
 
 
 MultiBandIntegrator::MultiBandIntegrator()
     : GenericProcessor  ("Multi-band Integrator")
+	, bandFilter        (engine.getBandFilter())
     , inputChan         (0)
-	, rollDur           (1000)
-	, alphaLow          (6.0f)
-	, alphaHigh         (9.0f)
-	, alphaGain         (1.0f)
-	, betaLow           (13.0f)
-	, betaHigh          (18.0f)
-	, betaGain          (1.0f)
-	, deltaLow          (1.0f)
-	, deltaHigh         (4.0f)
-	, deltaGain         (1.0f)
+	, multiChannel      (false)
+	, statisticsOutput  (false)
+	, thresholdEnabled  (false)
+	, statsChunk        (OUTPUT_CHUNK)
+	, discardChunk      (OUTPUT_CHUNK)
 {
     setProcessorType(PROCESSOR_TYPE_FILTER);
 
-	
+	bandFilter.setNumBands(getNumBands());
 
+	//scale the output so that its units are more useful
+	engine.setOutputGain(IntegratorSettings::outputGain);
 
+	engine.setTimer(&timer);
 }
 
 MultiBandIntegrator::~MultiBandIntegrator() {}
@@ -69,16 +65,13 @@ void MultiBandIntegrator::createEventChannels()
     const DataChannel* in = getDataChannel(inputChan);
     float sampleRate = in ? in->getSampleRate() : CoreServices::getGlobalSampleRate();
 
-	//create accumulator and buffers for filtering
+	//design filters for the input channel's sample rate
 	//snuck in with create event channels because it only 
 
-	deltaAcc acc(bt::rolling_window::window_size = sampleRate);
-
-	scratchBuffer = AudioSampleBuffer(5, sampleRate); // 5-dimensional buffer to hold band-filtered, averaged data
-
-
+	prepareEngine();
 	setFilterParameters();
 	setRollingWindowParameters();
+	setThresholdParameters();
 
 }
 
@@ -87,69 +80,146 @@ void MultiBandIntegrator::createEventChannels()
 	
 //}
 
-void MultiBandIntegrator::setRollingWindowParameters()
+int MultiBandIntegrator::getNumProcessedChannels() const
 {
-	//set rolling buffer size
-	int sampRate = dataChannelArray[inputChan]->getSampleRate();
-	int buffSize = sampRate*rollDur / 1000;
-	rollBuffer = AudioSampleBuffer(2, buffSize);    // buffer for rolling average data
+	return multiChannel ? jmax(integratedChannels.size(), 1) : 1;
+}
 
+int MultiBandIntegrator::getRateChannel() const
+{
+	if (multiChannel && integratedChannels.size() > 0)
+		return integratedChannels[0];
+	return inputChan;
 }
 
-void MultiBandIntegrator::setFilterParameters()
+void MultiBandIntegrator::setIntegratedChannels(const Array<int>& channels)
 {
+	if (CoreServices::getAcquisitionStatus())
+		return;
 
+	integratedChannels.clearQuick();
+	for (int chan : channels)
+	{
+		if (chan >= 0 && chan < getNumInputs())
+			integratedChannels.add(chan);
+	}
 
-	//design 3 filters with similar properties
+	channelPointers.resize(integratedChannels.size());
+	prepareEngine();
 
-	int sampRate = dataChannelArray[inputChan]->getSampleRate();
+	if (getNumInputs() > 0)
+	{
+		setFilterParameters();
+		setRollingWindowParameters();
+		setThresholdParameters();
+	}
+}
 
-	for (int n = 0; n < 3; n = n + 1)
+int MultiBandIntegrator::getDesignRate() const
+{
+	return dataChannelArray[getRateChannel()]->getSampleRate();
+}
+
+void MultiBandIntegrator::prepareEngine()
+{
+	//allocate the rolling window for the longest allowed duration, so that changing the
+	//duration later never needs memory from the audio thread
+	if (getNumInputs() > 0)
 	{
-		filters.add(new Dsp::SmoothedFilterDesign
-			<Dsp::Butterworth::Design::BandPass    // design type
-			<2>,                                   // order
-			1,                                     // number of channels (must be const)
-			Dsp::DirectFormII>(1));               // realization
+		int sampRate = getDesignRate();
+		timer.setSampleRate(sampRate);
+		engine.prepare(getNumProcessedChannels(), integratorSettings.getMaxWindowSize(sampRate),
+			integratorSettings.getDecimationFactor(sampRate));
+	}
+	else
+	{
+		engine.prepare(getNumProcessedChannels(), 1);
 	}
-	//alpha (fundamental) frequency parameters
-	//alphaHigh = 9;
-	//alphaLow = 6;
-	Dsp::Params alphaParams;
-	alphaParams[0] = sampRate; // sample rate
-	alphaParams[1] = 2;                          // order
-	alphaParams[2] = (alphaHigh + alphaLow) / 2;     // center frequency
-	alphaParams[3] = alphaHigh - alphaLow;           // bandwidth
-
-	filters[0]->setParams(alphaParams);
-	
-	//beta (harmonic) frequency paramteters
-	//betaHigh = 18;
-	//betaLow = 13;
-	Dsp::Params betaParams;
-	betaParams[0] = sampRate;
-	betaParams[1] = 2;
-	betaParams[2] = (betaHigh + betaLow) / 2;
-	betaParams[3] = betaHigh - betaLow;
 
-	filters[1]->setParams(betaParams);
+	threshold.prepare(getNumProcessedChannels());
+}
 
-	//delta frequency parameters
-	//deltaHigh = 4;
-	//deltaLow = 1;
-	Dsp::Params deltaParams;
-	deltaParams[0] = sampRate;
-	deltaParams[1] = 2;
-	deltaParams[2] = (deltaHigh + deltaLow) / 2;
-	deltaParams[3] = deltaHigh - deltaLow;
+void MultiBandIntegrator::updateDecimation()
+{
+	if (CoreServices::getAcquisitionStatus() || getNumInputs() == 0)
+		return;
 
-	filters[2]->setParams(deltaParams);
+	if (integratorSettings.getDecimationFactor(getDesignRate()) != engine.getDecimationFactor())
+	{
+		prepareEngine();
+		setFilterParameters();
+		setRollingWindowParameters();
+		setThresholdParameters();
+	}
+}
+
+float MultiBandIntegrator::getMaxBandFrequency() const
+{
+	int factor = engine.getDecimationFactor();
+	if (factor == 1 || getNumInputs() == 0)
+		return FLT_MAX;
+
+	return IntegratorSettings::getMaxBandFrequency(getDesignRate(), factor);
+}
+
+void MultiBandIntegrator::setRollingWindowParameters()
+{
+	//set rolling buffer size
+	integratorSettings.applyWindow(engine, getDesignRate());
+}
 
+void MultiBandIntegrator::setThresholdParameters()
+{
+	//the horizon is counted in output samples
+	if (getNumInputs() > 0)
+		integratorSettings.applyThreshold(threshold, dataChannelArray[getRateChannel()]->getSampleRate());
 
+	//process() reads this flag instead of integratorSettings. set after the level, so that the
+	//threshold never runs a block with the level it had while it was off
+	thresholdEnabled = integratorSettings.hasThreshold();
+}
+
+void MultiBandIntegrator::setFilterParameters()
+{
+	//design one band-pass filter per band
+	integratorSettings.applyBands(engine, getDesignRate());
+}
+
+void MultiBandIntegrator::handleAsyncUpdate()
+{
+	//design the bands that changed and swap them in at the next block boundary
+	bandFilter.publish();
 }
 
 void MultiBandIntegrator::process(AudioSampleBuffer& continuousBuffer)
 {
+	//nothing below may allocate (checked in builds with MBI_ALLOCATION_CHECK)
+	const ScopedNoAllocation noAllocation;
+
+	//time the whole block (checked against the block's duration in builds with MBI_PROFILING)
+	ScopedStageTimer blockTimer(&timer, ProcessTimer::blockStage);
+
+	if (multiChannel)
+	{
+		//integrate every selected channel in place, all channels stepping through time together
+		int numChans = 0;
+		for (int chan : integratedChannels)
+		{
+			if (chan < continuousBuffer.getNumChannels())
+				channelPointers.set(numChans++, continuousBuffer.getWritePointer(chan));
+		}
+
+		if (numChans == 0 || numChans != engine.getNumChannels())
+			return;
+
+		int nSamples = getNumSamples(integratedChannels[0]);
+		blockTimer.setNumSamples(nSamples);
+		float* const* ptrs = channelPointers.getRawDataPointer();
+
+		engine.process(ptrs, ptrs, nSamples);
+		return;
+	}
+
     // state to keep constant during each call
     int currChan = inputChan;
 
@@ -157,6 +227,7 @@ void MultiBandIntegrator::process(AudioSampleBuffer& continuousBuffer)
         return;
 
     int nSamples = getNumSamples(currChan);
+    blockTimer.setNumSamples(nSamples);
     const float* rp = continuousBuffer.getReadPointer(currChan);
 
 	//get adjacent channel numbers to display raw data, pre-averaged signal
@@ -179,149 +250,27 @@ void MultiBandIntegrator::process(AudioSampleBuffer& continuousBuffer)
 		rawChan = currChan - 2;
 	}
 
-	//copy channel to scractchBuffer channels for processing
-
-	for (int n = 0; n < 3; n = n + 1)
-	{
-		 scratchBuffer.copyFrom(n,
-	                   	       	0,
-		                      	continuousBuffer,
-			                    currChan,
-			                    0,
-			                    nSamples);
-	}
-
-	//filter channel in alpha band and set gain
-	float* ptrA = scratchBuffer.getWritePointer(0);
-	filters[0]->process(nSamples, &ptrA);
-	//const float alphaGain = 7.0f;
-	scratchBuffer.applyGain(0,
-		                    0,
-		                    nSamples,
-	                        alphaGain);
-
-	//filter copied channel in beta band and set gain
-	float* ptrB = scratchBuffer.getWritePointer(1);
-	filters[1]->process(nSamples, &ptrB);
-	scratchBuffer.applyGain(1,
-		                    0,
-		                    nSamples,
-		                    betaGain);
-
-	//filter copied channel in delta band and set gain
-	float* ptrD = scratchBuffer.getWritePointer(2);
-	filters[2]->process(nSamples, &ptrD);
-	scratchBuffer.applyGain(2,
-			                0,
-		                    nSamples,
-		                    deltaGain);
-
-	//copy raw data from input/trigger channel to adjacent channel for viewing
-	continuousBuffer.copyFrom(rawChan,
-		                      0,
-		                      continuousBuffer,
-		                      currChan,
-		                      0,
-		                      nSamples);
-
-	//add alpha, beta, and delta channels together in continuous buffer, adding gain to the beta 
-	//and delta bands
-	continuousBuffer.copyFrom(currChan,
-	  	                      0,
-		                      scratchBuffer,
-	                          0,
-		                      0,
-		                      nSamples);
-
-	continuousBuffer.addFrom(currChan,			//dest channel
-		                     0,                 //dest start sample
-		                     scratchBuffer,  //source buffer
-		                     1,          //source channel
-		                     0,                 //source start sample
-		                     nSamples);          //num samples
-		                     //betaGain);             //gain
-
-	continuousBuffer.addFrom(currChan,
-		                     0,
-		                     scratchBuffer,
-		                     2,
-		                     0,
-		                     nSamples);
-		                     //deltaGain);
-
-	//show unaveraged trigger signal on output channel adjacent to 
-	//input/triggering channel
-
-	continuousBuffer.copyFrom(preAvgChan,
-							  0,
-		                      continuousBuffer,
-		                      currChan,
-		                      0,
-		                      nSamples);
-	
-
-	//apply a 1s rolling average do delta band
-	//initialize constants
-	int sampRate = dataChannelArray[currChan]->getSampleRate();
-	int rollSamples = rollBuffer.getNumSamples();
-	int rollAdd = rollSamples - nSamples;
-	
-	//initialize accumulator with 1 second rolling window
-	deltaAcc acc(bt::rolling_window::window_size = rollSamples);
-	float rollM;
-
-	//push previous 1 second of differentiated data into the accumulator
-	for (int i = 0; i < rollSamples-1; i++)
-	{
-		acc(std::fabs(rollBuffer.getSample(0, i+1)-rollBuffer.getSample(0,i)));
-		//acc(rollBuffer.getSample(0, i));
-	}
-
-	//push new data into accumulator and get rolling average
-	//acc(continuousBuffer.getSample(0, 0) - rollBuffer.getSample(0,sampRate));
-	rollM = boost::accumulators::rolling_mean(acc);
-	scratchBuffer.setSample(3, 0, rollM);
-	//acc(rollBuffer.getSample(0, sampRate));
-	for (int i = 0; i < nSamples-1; i++)
-	{
-		acc(std::fabs(continuousBuffer.getSample(currChan, i + 1) - continuousBuffer.getSample(currChan, i)));
-		rollM = boost::accumulators::rolling_mean(acc);
-		//put the rolling mean into channel 3(4) of the scratch buffer
-		scratchBuffer.setSample(3, i+1, rollM);
-	}
-
-
-	//update rolling buffer, making sure to put new samples at 
-	//the end for smooth rolling!
-
-	rollBuffer.copyFrom(0,
-		0,
-		rollBuffer,
-		0,
-		nSamples,
-		rollAdd);
-
-	rollBuffer.copyFrom(0,
-		rollAdd,
-		continuousBuffer,
-		currChan,
-		0,
-		nSamples);
-
-
-	//temporarily add gain to output signal so that its units are more useful
-	scratchBuffer.applyGain(3, 0, nSamples, 100);
-
-	//overwrite the triggering channel with 1s averaged data
-	continuousBuffer.copyFrom(currChan,
-		                      0,
-		                      scratchBuffer,
-		                      3,
-		                      0,
-		                      nSamples);
-
-	scratchBuffer.applyGain(3, 0, nSamples, 1);
+	//filter the input channel in every band, sum the bands and apply the rolling average of
+	//the sum's absolute first difference, all in one pass. the integrator carries its window
+	//over from the previous block, so each new sample only adds one difference and drops the
+	//oldest one. along the way, copy the raw input to one adjacent channel and show the
+	//unaveraged trigger signal on the other
+	float* wpCurr = continuousBuffer.getWritePointer(currChan);
+	float* wpRaw = continuousBuffer.getWritePointer(rawChan);
+	float* wpPreAvg = continuousBuffer.getWritePointer(preAvgChan);
+
+	//with an adaptive threshold, the threshold takes the raw input's place
+	const bool withThreshold = thresholdEnabled.load();
+	float* wpRawCopy = withThreshold ? nullptr : wpRaw;
+
+	if (engine.getStatisticsEnabled() || engine.getNumExtraWindows() > 0)
+		processWithExtraOutputs(continuousBuffer, rp, wpCurr, wpRawCopy, wpPreAvg,
+			jmax(currChan, preAvgChan, rawChan) + 1, nSamples);
+	else
+		engine.process(&rp, &wpCurr, nSamples, wpRawCopy != nullptr ? &wpRawCopy : nullptr, &wpPreAvg);
 
+	if (withThreshold)
+		threshold.process(&wpCurr, &wpRaw, nSamples);
 
 
 
@@ -340,6 +289,61 @@ void MultiBandIntegrator::process(AudioSampleBuffer& continuousBuffer)
     
 }
 
+void MultiBandIntegrator::processWithExtraOutputs(AudioSampleBuffer& continuousBuffer, const float* rp, float* wpCurr,
+	float* wpRaw, float* wpPreAvg, int firstExtraChan, int nSamples)
+{
+	//the statistics go to the channels after the ones written above, then the extra windows, as many
+	//of them as there are channels for. windows without a channel are written to a scratch buffer
+	const bool withStats = engine.getStatisticsEnabled();
+	const int numWindows = engine.getNumExtraWindows();
+	const int numChans = continuousBuffer.getNumChannels();
+	int chan = firstExtraChan;
+
+	float* wpStats[NUM_STATISTICS];
+	int numStats = 0;
+	while (withStats && numStats < NUM_STATISTICS && chan < numChans)
+		wpStats[numStats++] = continuousBuffer.getWritePointer(chan++);
+
+	float* wpWindows[MAX_EXTRA_WINDOWS];
+	int numWindowChans = 0;
+	while (numWindowChans < numWindows && chan < numChans)
+		wpWindows[numWindowChans++] = continuousBuffer.getWritePointer(chan++);
+
+	//the engine writes them a chunk at a time into buffers allocated up front, since the block
+	//length isn't known in advance. the engine's state carries over from chunk to chunk, so the
+	//result is the same as in one call (only its stage timings are per chunk)
+	RollingStatistics::Moments* moments = statsChunk.data();
+	float* windowChunks[MAX_EXTRA_WINDOWS];
+	float* const* windowOut[MAX_EXTRA_WINDOWS];
+	for (int w = 0; w < numWindows; w++)
+	{
+		windowChunks[w] = discardChunk.data();
+		windowOut[w] = &windowChunks[w];
+	}
+
+	for (int start = 0; start < nSamples; start += OUTPUT_CHUNK)
+	{
+		int n = jmin(static_cast<int>(OUTPUT_CHUNK), nSamples - start);
+		const float* in = rp + start;
+		float* out = wpCurr + start;
+		float* raw = wpRaw != nullptr ? wpRaw + start : nullptr;
+		float* preAvg = wpPreAvg + start;
+		for (int w = 0; w < numWindowChans; w++)
+			windowChunks[w] = wpWindows[w] + start;
+
+		engine.process(&in, &out, n, raw != nullptr ? &raw : nullptr, &preAvg,
+			withStats ? &moments : nullptr, numWindows > 0 ? windowOut : nullptr);
+
+		for (int i = 0; i < n && numStats > 0; i++)
+		{
+			const RollingStatistics::Moments& m = moments[i];
+			const float values[NUM_STATISTICS] = { m.mean, m.variance, m.rms, m.skewness, m.kurtosis };
+			for (int k = 0; k < numStats; k++)
+				wpStats[k][start + i] = values[k];
+		}
+	}
+}
+
 // all new values should be validated before this function is called!
 void MultiBandIntegrator::setParameter(int parameterIndex, float newValue)
 {
@@ -351,56 +355,163 @@ void MultiBandIntegrator::setParameter(int parameterIndex, float newValue)
         break;
 		
 	case pRollDur:
-		rollDur = newValue;
+		integratorSettings.rollDur = jlimit(0.0f, static_cast<float>(MAX_ROLL_DUR), newValue);
 		setRollingWindowParameters();
 		break;
 
-	case pAlphaLow:
-		alphaLow = newValue;
-		setFilterParameters();
+	case pThresholdLevel:
+		integratorSettings.thresholdLevel = jlimit(0.0f, 99.9f, newValue);
+		setThresholdParameters();
 		break;
 
-	case pAlphaHigh:
-		alphaHigh = newValue;
-		setFilterParameters();
+	case pThresholdHorizon:
+		integratorSettings.thresholdHorizon = jlimit(0.0f, static_cast<float>(MAX_THRESHOLD_HORIZON), newValue);
+		setThresholdParameters();
 		break;
 
-	case pAlphaGain:
-		alphaGain = newValue;
+	case pMultiChannel:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		multiChannel = newValue != 0;
+		engine.setStatisticsEnabled(statisticsOutput && !multiChannel);
+		engine.setNumExtraWindows(multiChannel ? 0 : getNumExtraWindows());
+		prepareEngine();
+		if (getNumInputs() > 0)
+		{
+			setFilterParameters();
+			setRollingWindowParameters();
+			setThresholdParameters();
+		}
 		break;
 
-	case pBetaLow:
-		betaLow = newValue;
-		setFilterParameters();
+	case pDecimation:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		integratorSettings.decimation = jlimit(1, MAX_DECIMATION, static_cast<int>(newValue));
+		prepareEngine();
+		if (getNumInputs() > 0)
+		{
+			setFilterParameters();
+			setRollingWindowParameters();
+			setThresholdParameters();
+		}
 		break;
-	
-	case pBetaHigh:
-		betaHigh = newValue;
-		setFilterParameters();
+
+	case pStatistics:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		//only single-channel mode has channels to spare for them
+		statisticsOutput = newValue != 0;
+		engine.setStatisticsEnabled(statisticsOutput && !multiChannel);
 		break;
 
-	case pBetaGain:
-		betaGain = newValue;
+	case pNumExtraWindows:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		//new windows start out as long as the main one; like the statistics, single-channel mode only
+		integratorSettings.extraRollDurs.resize(jlimit(0, static_cast<int>(MAX_EXTRA_WINDOWS), static_cast<int>(newValue)),
+			integratorSettings.rollDur);
+		engine.setNumExtraWindows(multiChannel ? 0 : getNumExtraWindows());
+		if (getNumInputs() > 0)
+			setRollingWindowParameters();
 		break;
 
-	case pDeltaLow:
-		deltaLow = newValue;
-		setFilterParameters();
+	case pIntegratorMode:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		integratorSettings.integratorMode = static_cast<IntegratorEngine::IntegratorMode>(
+			jlimit<int>(IntegratorEngine::rollingMode, IntegratorEngine::cascadedMode, static_cast<int>(newValue)));
+		engine.setIntegratorMode(integratorSettings.integratorMode, integratorSettings.cascadeStages);
 		break;
-		
-	case pDeltaHigh:
-		deltaHigh = newValue;
-		setFilterParameters();
+
+	case pCascadeStages:
+		if (CoreServices::getAcquisitionStatus())
+			break;
+
+		integratorSettings.cascadeStages = jlimit<int>(CascadedLineLength::minStages, CascadedLineLength::maxStages,
+			static_cast<int>(newValue));
+		engine.setIntegratorMode(integratorSettings.integratorMode, integratorSettings.cascadeStages);
 		break;
 
-	case pDeltaGain:
-		deltaGain = newValue;
+	case pNumBands:
+	{
+		int numBands = jlimit(1, MAX_BANDS, static_cast<int>(newValue));
+		int oldNumBands = getNumBands();
+		std::vector<FrequencyBand>& bands = integratorSettings.bands;
+
+		// new bands don't contribute to the sum until they are given a gain
+		const FrequencyBand newBand = { 1.0f, 4.0f, 0.0f };
+		bands.resize(numBands, newBand);
+
+		bandFilter.setNumBands(numBands);
+		for (int n = oldNumBands; n < numBands; n++)
+			bandFilter.setBand(n, bands[n].low, bands[n].high, bands[n].gain);
+		triggerAsyncUpdate();
+		updateDecimation();
 		break;
+	}
+
+	default:
+	{
+		int window = parameterIndex - pFirstExtraWindow;
+		if (window >= 0 && window < MAX_EXTRA_WINDOWS)
+		{
+			if (window < getNumExtraWindows())
+			{
+				integratorSettings.extraRollDurs[window] = jlimit(0.0f, static_cast<float>(MAX_ROLL_DUR), newValue);
+				if (getNumInputs() > 0)
+					setRollingWindowParameters();
+			}
+			break;
+		}
+
+		int band = (parameterIndex - pFirstBandParam) / NUM_BAND_PARAMS;
+		if (parameterIndex < pFirstBandParam || band >= getNumBands())
+			break;
+
+		FrequencyBand& b = integratorSettings.bands[band];
+		switch ((parameterIndex - pFirstBandParam) % NUM_BAND_PARAMS)
+		{
+		case pBandLow:
+			b.low = newValue;
+			bandFilter.setBand(band, b.low, b.high, b.gain);
+			break;
+
+		case pBandHigh:
+			b.high = newValue;
+			bandFilter.setBand(band, b.low, b.high, b.gain);
+			break;
+
+		case pBandGain:
+			b.gain = newValue;
+			bandFilter.setGain(band, b.gain);
+			break;
+		}
+		triggerAsyncUpdate();
+		updateDecimation();
+		break;
+	}
     }
 }
 
+bool MultiBandIntegrator::enable()
+{
+	timer.reset();
+	return GenericProcessor::enable();
+}
+
 bool MultiBandIntegrator::disable()
 {
+	//keep the timing of the last acquisition (only written in builds with MBI_PROFILING)
+	File report = File::getSpecialLocation(File::tempDirectory)
+		.getChildFile("MultiBandIntegrator-" + String(getNodeId()) + "-timing.txt");
+	if (timer.writeReport(report.getFullPathName().toRawUTF8()))
+		std::cout << "Multi-band Integrator: timing written to " << report.getFullPathName() << std::endl;
 
     return true;
 }
@@ -22,7 +22,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 */
 
 
-// The multi-band integrator allows the user to take a weighted sum of up to 3 frequency bands and apply a rolling average to build
+// The multi-band integrator allows the user to take a weighted sum of any number of frequency bands and apply a rolling average to build
 // a power signal for complex waveforms with well-defined spectral properties.  It was initially developed to detect absence-like seizures
 // in real time from EEG recorded in awake, head-fixed mice.
 
@@ -33,7 +33,22 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 // by an LFP viewer to show how the input channel is being filtered.  The other contains a second LFP viewer to show all of the channels without
 // any multi-band integrator processing
 
+// In multi-channel mode, every channel selected in the editor's channel selector is integrated by the same
+// processor and replaced with its own integrated signal. No channels are overwritten with intermediate signals
+// in this mode, and all selected channels are assumed to share one sample rate.
+
 // This plugin can be used with the third party crossing detector plugin to trigger events based on the processed output from the multi-band integrator.
+// Instead of a hand-tuned threshold, the crossing detector can follow an adaptive one: if a threshold percentile is set, the running
+// estimate of that percentile of the output (see AdaptiveThreshold) is written to the adjacent channel that otherwise holds the raw input.
+// The threshold is only available in single-channel mode.
+
+// Also in single-channel mode, the rolling mean, variance, RMS, skewness and kurtosis of the weighted sum over the same
+// window (see RollingStatistics) can be written to the five channels after the three above, and the output over up to
+// eight extra window durations (see MultiWindowLineLength) to the channels after those, as far as the input has them.
+// Both are off by default.
+
+// Instead of a plain rolling mean, the window can be averaged with a single-pole exponential average, which keeps no
+// history at all, or with a cascade of 2 to 4 shorter rolling means for a smoother response (see IntegratorEngine).
 
 
 #ifndef MULTIBAND_INTEGRATOR_H_INCLUDED
@@ -46,33 +61,52 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 #include <ProcessorHeaders.h>
 #include <algorithm> // max
-#include "Dsp/Dsp.h" // filtering
-#include "boostAcc/boost/accumulators/accumulators.hpp"
-#include "boostAcc/boost/accumulators/statistics.hpp"
-#include "boostAcc/boost/accumulators/statistics/rolling_mean.hpp"
-
-namespace ba = boost::accumulators;
-namespace bt = ba::tag;
-typedef ba::accumulator_set < double, ba::stats < bt::rolling_mean > > deltaAcc;
-
+#include <atomic>
+#include <cfloat>    // FLT_MAX
+#include "IntegratorSettings.h" // bands, window and decimation, and the engine that applies them
+#include "AllocationCheck.h"
+#include "ProcessTimer.h"
 
 
 enum
 {
 	pInputChan,
 	pRollDur,
-	pAlphaLow,
-	pAlphaHigh,
-	pAlphaGain,
-	pBetaLow,
-	pBetaHigh,
-	pBetaGain,
-	pDeltaLow,
-	pDeltaHigh,
-	pDeltaGain
+	pNumBands,
+	pMultiChannel,     // 0 = integrate inputChan only, 1 = integrate every channel in integratedChannels
+	pDecimation,       // factor to decimate by ahead of the band filters (power of two, 1 = off)
+	pThresholdLevel,   // percentile of the output followed by the adaptive threshold (0 = off)
+	pThresholdHorizon, // seconds over which the adaptive threshold forgets (0 = whole session)
+	pIntegratorMode,   // kernel that averages over the window, see IntegratorEngine::IntegratorMode
+	pCascadeStages,    // rolling means in a row when the kernel is cascaded
+	pStatistics,       // 1 = write the rolling statistics of the weighted sum to five more channels (single channel only)
+	pNumExtraWindows,  // extra window durations to write the output over, one channel each (single channel only)
+	pFirstExtraWindow, // duration of each extra window (ms), see extraWindowParam()
+	pFirstBandParam = pFirstExtraWindow + MultiWindowLineLength::maxWindows   // per-band parameters follow, see bandParam()
+};
+
+// parameter index for the duration of one extra window
+inline int extraWindowParam(int window)
+{
+	return pFirstExtraWindow + window;
+}
+
+// parameters of each frequency band, indexed relative to the band's first parameter
+enum
+{
+	pBandLow,
+	pBandHigh,
+	pBandGain,
+	NUM_BAND_PARAMS
 };
 
-class MultiBandIntegrator : public GenericProcessor
+// parameter index for one field of one band, to pass to setParameter
+inline int bandParam(int band, int param)
+{
+	return pFirstBandParam + band * NUM_BAND_PARAMS + param;
+}
+
+class MultiBandIntegrator : public GenericProcessor, private AsyncUpdater
 {
     friend class MultiBandIntegratorEditor;
 
@@ -93,38 +127,107 @@ public:
 
 	void setRollingWindowParameters();
 
+	void setThresholdParameters();
+
     void process(AudioSampleBuffer& continuousBuffer) override;
 
     void setParameter(int parameterIndex, float newValue) override;
 
+    bool enable() override;
+
     bool disable() override;
 
+    // channels to integrate in multi-channel mode; only takes effect while not acquiring
+    void setIntegratedChannels(const Array<int>& channels);
+
+    int getNumBands() const { return static_cast<int>(integratorSettings.bands.size()); }
+    FrequencyBand getBand(int band) const { return integratorSettings.bands[band]; }
+
+    static const int MAX_BANDS = IntegratorSettings::maxBands;
+
+    // longest rolling window (ms); the window's memory is allocated for this length up front so that
+    // the duration can be changed during acquisition
+    static const int MAX_ROLL_DUR = IntegratorSettings::maxRollDur;
+
+    static const int MAX_DECIMATION = IntegratorSettings::maxDecimation;
+
+    static const int MAX_THRESHOLD_HORIZON = IntegratorSettings::maxThresholdHorizon;
+
+    // mean, variance, rms, skewness and kurtosis
+    static const int NUM_STATISTICS = 5;
+
+    bool getStatisticsOutput() const { return statisticsOutput; }
+
+    static const int MAX_EXTRA_WINDOWS = MultiWindowLineLength::maxWindows;
+
+    int getNumExtraWindows() const { return static_cast<int>(integratorSettings.extraRollDurs.size()); }
+
+    // decimation factor actually in use; lower than the one asked for if a band would otherwise
+    // reach outside the decimator's passband
+    int getDecimationFactor() const { return engine.getDecimationFactor(); }
+
+    // highest band edge (Hz) that is safe at the current decimation factor
+    float getMaxBandFrequency() const;
+
+    // block timing and overruns of process(), readable from any thread; only collected in builds
+    // with MBI_PROFILING. Cleared when acquisition starts and written to a file in the temporary
+    // directory when it stops
+    ProcessTimer& getTimer() { return timer; }
+
 private:
+	// publishes band edits to the audio thread; edits made in quick succession go out together
+	void handleAsyncUpdate() override;
+
 	// ----- filters---------
-	
-	OwnedArray<Dsp::Filter> filters;
-	
-	AudioSampleBuffer scratchBuffer;
-	AudioSampleBuffer rollBuffer;
-
-	float rollDur;
-
-	float alphaLow;
-	float alphaHigh;
-	float alphaGain;
-	
-	float betaLow;
-	float betaHigh;
-	float betaGain;
-	int betaChan;
-
-	float deltaLow;
-	float deltaHigh;
-	float deltaGain;
-	int deltaChan;
+
+	// band filters, weighted sum and line-length integrator, fused into one pass over each block.
+	// the integrator keeps its window across calls to process(). band edits from the editor are
+	// staged in bandFilter and picked up by process() at the start of a block
+	IntegratorEngine engine;
+	MultiBandFilter& bandFilter;
+
+	// running percentile of the output, one per processed channel; level and horizon changes are
+	// picked up at the start of a block
+	AdaptiveThreshold threshold;
+
+	// rolling window duration, decimation factor asked for, band table and threshold
+	IntegratorSettings integratorSettings;
+
+	ProcessTimer timer;
 
     int inputChan;
 
+	bool multiChannel;
+	bool statisticsOutput;   // asked for; only computed in single-channel mode
+	std::atomic<bool> thresholdEnabled;   // integratorSettings.hasThreshold(), for the audio thread
+	Array<int> integratedChannels;
+	Array<float*> channelPointers;   // write pointers of the channels being integrated, refilled every block
+
+	// samples per engine call while the statistics or extra windows are written out
+	static const int OUTPUT_CHUNK = 256;
+	std::vector<RollingStatistics::Moments> statsChunk;
+	std::vector<float> discardChunk;   // output of extra windows that have no channel left
+
+	// runs the single-channel path a chunk at a time and gives each statistic and extra window its own
+	// channel, starting at firstExtraChan
+	void processWithExtraOutputs(AudioSampleBuffer& continuousBuffer, const float* rp, float* wpCurr,
+		float* wpRaw, float* wpPreAvg, int firstExtraChan, int nSamples);
+
+	// allocates the engine's working memory for the current channels; only called while not acquiring
+	void prepareEngine();
+
+	// sample rate (rounded down to whole Hz) that the filters and rolling window are designed for
+	int getDesignRate() const;
+
+	// re-prepares the engine if band edits changed the usable decimation factor (not while acquiring)
+	void updateDecimation();
+
+	// number of channels run through the engine in the current mode
+	int getNumProcessedChannels() const;
+
+	// channel whose sample rate the filters and rolling window are designed for
+	int getRateChannel() const;
+
 
     EventChannel* eventChannelPtr;
     MetaDataDescriptorArray eventMetaDataDescriptors;
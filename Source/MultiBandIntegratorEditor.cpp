@@ -26,7 +26,7 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 MultiBandIntegratorEditor::MultiBandIntegratorEditor(GenericProcessor* parentNode, bool useDefaultParameterEditors)
     : GenericEditor(parentNode, useDefaultParameterEditors)
 {
-	desiredWidth = 250;
+	desiredWidth = 320;
 
     MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(parentNode);
 
@@ -40,10 +40,24 @@ MultiBandIntegratorEditor::MultiBandIntegratorEditor(GenericProcessor* parentNod
     inputLabel = createLabel("InputChanL", "In:", Rectangle(xPos, yPos, 30, TEXT_HT));
     addAndMakeVisible(inputLabel);
 
-	rollLabel1 = createLabel("rollL1", "Window", Rectangle(xPos, yPos += 30, 70, TEXT_HT));
-	addAndMakeVisible(rollLabel1);
-
-	rollEdit = createEditable("rollE", String(processor->rollDur), "",
+	kernelBox = new ComboBox("Kernel");
+	kernelBox->setTooltip("How the window is averaged: a rolling mean, an exponential average with the same "
+		"mean age (no stored window), or a cascade of 2 to 4 rolling means for a smoother response");
+	kernelBox->addItem("Rolling", ROLLING_ID);
+	kernelBox->addItem("Exp.", EXPONENTIAL_ID);
+	for (int stages = CascadedLineLength::minStages; stages <= CascadedLineLength::maxStages; stages++)
+		kernelBox->addItem("Casc. " + String(stages), CASCADE_ID_OFFSET + stages);
+	if (processor->integratorSettings.integratorMode == IntegratorEngine::cascadedMode)
+		kernelBox->setSelectedId(CASCADE_ID_OFFSET + processor->integratorSettings.cascadeStages, dontSendNotification);
+	else if (processor->integratorSettings.integratorMode == IntegratorEngine::exponentialMode)
+		kernelBox->setSelectedId(EXPONENTIAL_ID, dontSendNotification);
+	else
+		kernelBox->setSelectedId(ROLLING_ID, dontSendNotification);
+	kernelBox->setBounds(xPos, yPos += 30, 72, TEXT_HT);
+	kernelBox->addListener(this);
+	addAndMakeVisible(kernelBox);
+
+	rollEdit = createEditable("rollE", String(processor->integratorSettings.rollDur), "",
 		Rectangle(xPos, yPos += 20, 40, TEXT_HT));
 	addAndMakeVisible(rollEdit);
 
@@ -55,85 +69,121 @@ MultiBandIntegratorEditor::MultiBandIntegratorEditor(GenericProcessor* parentNod
 	yPos = 36;
 
     inputBox = new ComboBox("Input channel");
-    inputBox->setTooltip("Continuous channel to analyze");
+    inputBox->setTooltip("Continuous channel to analyze, or \"Sel\" to integrate every channel selected in the channel selector");
     inputBox->setBounds(xPos += 33, yPos, 40, TEXT_HT);
     inputBox->addListener(this);
     addAndMakeVisible(inputBox);
 
+	decimLabel = createLabel("decimL", "Dec:", Rectangle(xPos = 12, yPos = 108, 33, TEXT_HT));
+	addAndMakeVisible(decimLabel);
+
+	decimBox = new ComboBox("Decimation");
+	decimBox->setTooltip("Decimate by this factor before filtering, so that the bands and the rolling "
+		"window run at a lower rate (1 = off). Reduced automatically if a band is too high for it");
+	for (int factor = 1; factor <= MultiBandIntegrator::MAX_DECIMATION; factor *= 2)
+		decimBox->addItem(String(factor), factor);
+	decimBox->setSelectedId(processor->integratorSettings.decimation, dontSendNotification);
+	decimBox->setBounds(xPos += 33, yPos, 40, TEXT_HT);
+	decimBox->addListener(this);
+	addAndMakeVisible(decimBox);
+
 	/* ---------------- Right Panel Frequency ranges and gains --------------- */
 
-	//frequency band low cutoffs
+	//band selector
 	int xPosR = 90;
 	int yPosR = 25;
 
 	freqLabel = createLabel("freqL", "Frequency bands", Rectangle(xPosR, yPosR, 150, TEXT_HT));
 	addAndMakeVisible(freqLabel);
 
-	freqLabelSub = createLabel("freqLS", "Low", Rectangle(xPosR, yPosR += 20, 50, TEXT_HT));
-	addAndMakeVisible(freqLabelSub);
+	bandLabel = createLabel("bandL", "Band", Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
+	addAndMakeVisible(bandLabel);
 
-	alphaLowEdit = createEditable("alphaLowE", String(processor->alphaLow), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(alphaLowEdit);
+	bandBox = new ComboBox("Band");
+	bandBox->setTooltip("Frequency band to edit");
+	bandBox->setBounds(xPosR + 35, yPosR, 45, TEXT_HT);
+	bandBox->addListener(this);
+	addAndMakeVisible(bandBox);
 
-	betaLowEdit = createEditable("betaLowE", String(processor->betaLow), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(betaLowEdit);
+	addBandButton = new UtilityButton("+", Font("Small Text", 13, Font::plain));
+	addBandButton->setTooltip("Add a frequency band (new bands start with a gain of 0)");
+	addBandButton->setBounds(xPosR + 85, yPosR, 20, TEXT_HT);
+	addBandButton->addListener(this);
+	addAndMakeVisible(addBandButton);
 
-	deltaLowEdit = createEditable("deltaLowE", String(processor->deltaLow), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(deltaLowEdit);
+	removeBandButton = new UtilityButton("-", Font("Small Text", 13, Font::plain));
+	removeBandButton->setTooltip("Remove the selected frequency band");
+	removeBandButton->setBounds(xPosR + 110, yPosR, 20, TEXT_HT);
+	removeBandButton->addListener(this);
+	addAndMakeVisible(removeBandButton);
 
-	//frequency band high cutoffs
+	//cutoffs and gain of the selected band
 
-	xPosR = 140;
-	yPosR = 45;
+	yPosR += 25;
 
-	freqLabelSub2 = createLabel("freqLS2", "High", Rectangle(xPosR, yPosR, 50, TEXT_HT));
+	freqLabelSub = createLabel("freqLS", "Low", Rectangle(xPosR, yPosR, 50, TEXT_HT));
+	addAndMakeVisible(freqLabelSub);
+
+	freqLabelSub2 = createLabel("freqLS2", "High", Rectangle(xPosR + 50, yPosR, 50, TEXT_HT));
 	addAndMakeVisible(freqLabelSub2);
-	
-	alphaHighEdit = createEditable("alphaHighE", String(processor->alphaHigh), "",
-		Rectangle(xPosR, yPosR +=20, 40, TEXT_HT));
-	addAndMakeVisible(alphaHighEdit);
 
-	betaHighEdit = createEditable("betaHighE", String(processor->betaHigh), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(betaHighEdit);
+	gainLabel = createLabel("gainL", "Gain", Rectangle(xPosR + 100, yPosR, 50, TEXT_HT));
+	addAndMakeVisible(gainLabel);
 
-	deltaHighEdit = createEditable("deltaHighE", String(processor->deltaHigh), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(deltaHighEdit);
+	yPosR += 20;
 
-	//frequency band gains
+	bandLowEdit = createEditable("bandLowE", "", "Low cutoff of the selected band (Hz)",
+		Rectangle(xPosR, yPosR, 40, TEXT_HT));
+	addAndMakeVisible(bandLowEdit);
 
-	xPosR = 190; 
-	yPosR = 45; 
-	
-	gainLabel = createLabel("gainL", "Gain", Rectangle(xPosR, yPosR, 50, TEXT_HT));
-	addAndMakeVisible(gainLabel);
+	bandHighEdit = createEditable("bandHighE", "", "High cutoff of the selected band (Hz)",
+		Rectangle(xPosR + 50, yPosR, 40, TEXT_HT));
+	addAndMakeVisible(bandHighEdit);
+
+	bandGainEdit = createEditable("bandGainE", "", "Weight of the selected band in the sum",
+		Rectangle(xPosR + 100, yPosR, 40, TEXT_HT));
+	addAndMakeVisible(bandGainEdit);
+
+	//rolling statistics of the sum
+	statsButton = new UtilityButton("Stats", Font("Small Text", 13, Font::plain));
+	statsButton->setTooltip("Write the rolling mean, variance, RMS, skewness and kurtosis of the weighted sum "
+		"to the five channels after the outputs (single channel only)");
+	statsButton->setClickingTogglesState(true);
+	statsButton->setToggleState(processor->getStatisticsOutput(), dontSendNotification);
+	statsButton->setBounds(xPosR, yPosR += 22, 50, TEXT_HT);
+	statsButton->addListener(this);
+	addAndMakeVisible(statsButton);
+
+	extraEdit = createEditable("extraE", getExtraWindowText(), "Extra window durations (ms), separated by commas: "
+		"the output over each is written to its own channel after the statistics (single channel only)",
+		Rectangle(xPosR + 55, yPosR, 85, TEXT_HT));
+	addAndMakeVisible(extraEdit);
 
-	//alphaLabel = createLabel("alphaL", "6-9Hz", Rectangle(xPosR, yPosR += 20, 100, TEXT_HT));
-	//addAndMakeVisible(alphaLabel);
+	/* ---------------- Adaptive threshold --------------- */
 
-	alphaEditable = createEditable("alphaE", String(processor->alphaGain), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT ));
-	addAndMakeVisible(alphaEditable);
+	int xPosT = 250;
+	int yPosT = 25;
 
-	//betaLabel = createLabel("betaL", "13-18Hz", Rectangle(xPosR, yPosR += 20, 100, TEXT_HT));
-	//addAndMakeVisible(betaLabel);
+	thresholdLabel = createLabel("thresholdL", "Threshold", Rectangle(xPosT, yPosT, 65, TEXT_HT));
+	addAndMakeVisible(thresholdLabel);
 
-	betaEditable = createEditable("betaE", String(processor->betaGain), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(betaEditable);
+	levelLabel = createLabel("levelL", "%ile", Rectangle(xPosT, yPosT += 20, 50, TEXT_HT));
+	addAndMakeVisible(levelLabel);
 
-	//deltaLabel = createLabel("deltaL", "1-4Hz", Rectangle(xPosR, yPosR += 20, 100, TEXT_HT));
-	//addAndMakeVisible(deltaLabel);
+	levelEdit = createEditable("levelE", String(processor->integratorSettings.thresholdLevel),
+		"Percentile of the output to follow as a detection threshold, written in place of the raw "
+		"input channel (0 = off, single channel only)", Rectangle(xPosT, yPosT += 20, 40, TEXT_HT));
+	addAndMakeVisible(levelEdit);
 
-	deltaEditable = createEditable("deltaE", String(processor->deltaGain), "",
-		Rectangle(xPosR, yPosR += 20, 40, TEXT_HT));
-	addAndMakeVisible(deltaEditable);
+	horizonLabel = createLabel("horizonL", "Horizon s", Rectangle(xPosT, yPosT += 25, 65, TEXT_HT));
+	addAndMakeVisible(horizonLabel);
 
+	horizonEdit = createEditable("horizonE", String(processor->integratorSettings.thresholdHorizon),
+		"Time over which the threshold forgets older output (0 = whole session)",
+		Rectangle(xPosT, yPosT += 20, 40, TEXT_HT));
+	addAndMakeVisible(horizonEdit);
 
+	updateBandControls();
 }
 
 MultiBandIntegratorEditor::~MultiBandIntegratorEditor() {}
@@ -141,114 +191,172 @@ MultiBandIntegratorEditor::~MultiBandIntegratorEditor() {}
 void MultiBandIntegratorEditor::comboBoxChanged(ComboBox* comboBoxThatHasChanged)
 {
     if (comboBoxThatHasChanged == inputBox)
-        getProcessor()->setParameter(pInputChan, static_cast<float>(inputBox->getSelectedId() - 1));
+    {
+        MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
+        if (inputBox->getSelectedId() == MULTI_CHANNEL_ID)
+        {
+            processor->setIntegratedChannels(getActiveChannels());
+            processor->setParameter(pMultiChannel, 1);
+        }
+        else
+        {
+            processor->setParameter(pMultiChannel, 0);
+            processor->setParameter(pInputChan, static_cast<float>(inputBox->getSelectedId() - 1));
+        }
+    }
+    else if (comboBoxThatHasChanged == bandBox)
+        updateBandControls();
+    else if (comboBoxThatHasChanged == decimBox)
+        getProcessor()->setParameter(pDecimation, static_cast<float>(decimBox->getSelectedId()));
+    else if (comboBoxThatHasChanged == kernelBox)
+    {
+        int id = kernelBox->getSelectedId();
+        if (id > EXPONENTIAL_ID)
+        {
+            getProcessor()->setParameter(pCascadeStages, static_cast<float>(id - CASCADE_ID_OFFSET));
+            getProcessor()->setParameter(pIntegratorMode, IntegratorEngine::cascadedMode);
+        }
+        else if (id == EXPONENTIAL_ID)
+            getProcessor()->setParameter(pIntegratorMode, IntegratorEngine::exponentialMode);
+        else
+            getProcessor()->setParameter(pIntegratorMode, IntegratorEngine::rollingMode);
+    }
 
 }
 
 void MultiBandIntegratorEditor::labelTextChanged(Label* labelThatHasChanged)
 {
 	MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
-	
-	if (labelThatHasChanged == alphaLowEdit)
-	{
-		int newVal;
-		bool success = updateIntLabel(labelThatHasChanged, 0, INT_MAX, processor->alphaLow, &newVal);
+	int band = getSelectedBand();
+	FrequencyBand currBand = processor->getBand(band);
 
-		if (success)
-			processor->setParameter(pAlphaLow, newVal);
-	}
-	else if (labelThatHasChanged == rollEdit)
+	// the decimation factor is fixed during acquisition, so band edges have to stay in its passband
+	float maxFreq = acquisitionIsActive ? processor->getMaxBandFrequency() : FLT_MAX;
+	
+	if (labelThatHasChanged == rollEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->rollDur, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, 0, MultiBandIntegrator::MAX_ROLL_DUR, processor->integratorSettings.rollDur, &newVal);
 
 		if (success)
 			processor->setParameter(pRollDur, newVal);
 	}
-	else if (labelThatHasChanged == alphaHighEdit)
+	else if (labelThatHasChanged == levelEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->alphaHigh, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, 0, 99.9f, processor->integratorSettings.thresholdLevel, &newVal);
 
 		if (success)
-			processor->setParameter(pAlphaHigh, newVal);
+			processor->setParameter(pThresholdLevel, newVal);
 	}
-	else if (labelThatHasChanged == alphaEditable)
+	else if (labelThatHasChanged == horizonEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, -FLT_MAX, FLT_MAX, processor->alphaGain, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, 0, MultiBandIntegrator::MAX_THRESHOLD_HORIZON,
+			processor->integratorSettings.thresholdHorizon, &newVal);
 
 		if (success)
-			processor->setParameter(pAlphaGain, newVal);
+			processor->setParameter(pThresholdHorizon, newVal);
 	}
-	else if (labelThatHasChanged == betaLowEdit)
+	else if (labelThatHasChanged == extraEdit)
 	{
-		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->betaLow, &newVal);
-
-		if (success)
-			processor->setParameter(pBetaLow, newVal);
+		// the number of windows is fixed during acquisition, only their durations may change
+		StringArray tokens;
+		tokens.addTokens(extraEdit->getText(), ", ", "");
+		tokens.removeEmptyStrings();
+
+		int numWindows = tokens.size();
+		bool valid = numWindows <= MultiBandIntegrator::MAX_EXTRA_WINDOWS &&
+			(!acquisitionIsActive || numWindows == processor->getNumExtraWindows());
+		for (int w = 0; w < numWindows && valid; w++)
+			valid = tokens[w].getFloatValue() > 0;
+
+		if (valid)
+		{
+			processor->setParameter(pNumExtraWindows, static_cast<float>(numWindows));
+			for (int w = 0; w < numWindows; w++)
+				processor->setParameter(extraWindowParam(w),
+					jmin(tokens[w].getFloatValue(), static_cast<float>(MultiBandIntegrator::MAX_ROLL_DUR)));
+		}
+
+		extraEdit->setText(getExtraWindowText(), dontSendNotification);
 	}
-	else if (labelThatHasChanged == betaHighEdit)
+	else if (labelThatHasChanged == bandLowEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->betaHigh, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, 0, maxFreq, currBand.low, &newVal);
 
 		if (success)
-			processor->setParameter(pBetaHigh, newVal);
+			processor->setParameter(bandParam(band, pBandLow), newVal);
 	}
-	else if (labelThatHasChanged == betaEditable)
+	else if (labelThatHasChanged == bandHighEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, -FLT_MAX, FLT_MAX, processor->betaGain, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, 0, maxFreq, currBand.high, &newVal);
 
 		if (success)
-			processor->setParameter(pBetaGain, newVal);
+			processor->setParameter(bandParam(band, pBandHigh), newVal);
 	}
-	else if (labelThatHasChanged == deltaLowEdit)
+	else if (labelThatHasChanged == bandGainEdit)
 	{
 		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->deltaLow, &newVal);
+		bool success = updateFloatLabel(labelThatHasChanged, -FLT_MAX, FLT_MAX, currBand.gain, &newVal);
 
 		if (success)
-			processor->setParameter(pDeltaLow, newVal);
+			processor->setParameter(bandParam(band, pBandGain), newVal);
 	}
-	else if (labelThatHasChanged == deltaHighEdit)
-	{
-		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, 0, FLT_MAX, processor->deltaHigh, &newVal);
 
-		if (success)
-			processor->setParameter(pDeltaHigh, newVal);
+}
+
+void MultiBandIntegratorEditor::buttonEvent(Button* button)
+{
+	MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
+	int numBands = processor->getNumBands();
+
+	if (button == addBandButton && numBands < MultiBandIntegrator::MAX_BANDS)
+	{
+		processor->setParameter(pNumBands, static_cast<float>(numBands + 1));
+		updateBandControls();
+		bandBox->setSelectedId(numBands + 1, sendNotificationSync);
 	}
-	else if (labelThatHasChanged == deltaEditable)
+	else if (button == removeBandButton && numBands > 1)
 	{
-		float newVal;
-		bool success = updateFloatLabel(labelThatHasChanged, -FLT_MAX, FLT_MAX, processor->deltaGain, &newVal);
-
-		if (success)
-			processor->setParameter(pDeltaGain, newVal);
+		// shift the bands after the selected one down, then drop the last
+		int band = getSelectedBand();
+		for (int n = band; n < numBands - 1; n++)
+		{
+			FrequencyBand next = processor->getBand(n + 1);
+			processor->setParameter(bandParam(n, pBandLow), next.low);
+			processor->setParameter(bandParam(n, pBandHigh), next.high);
+			processor->setParameter(bandParam(n, pBandGain), next.gain);
+		}
+		processor->setParameter(pNumBands, static_cast<float>(numBands - 1));
+		updateBandControls();
+	}
+	else if (button == statsButton)
+	{
+		processor->setParameter(pStatistics, statsButton->getToggleState() ? 1.0f : 0.0f);
 	}
-
 }
 
-
-
 void MultiBandIntegratorEditor::updateSettings()
 {
     MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
 
-    // update input combo box
+    // update input combo box (one item per channel, plus the multi-channel item)
     int numInputs = processor->settings.numInputs;
     int numBoxItems = inputBox->getNumItems();
-    if (numInputs != numBoxItems)
+    if (numInputs + 1 != numBoxItems)
     {
         int currId = inputBox->getSelectedId();
         inputBox->clear(dontSendNotification);
         for (int chan = 1; chan <= numInputs; chan++)
             // using 1-based ids since 0 is reserved for "nothing selected"
             inputBox->addItem(String(chan), chan);
-        if (numInputs > 0 && (currId < 1 || currId > numInputs))
+        inputBox->addItem("Sel", MULTI_CHANNEL_ID);
+        if (currId == MULTI_CHANNEL_ID)
+            inputBox->setSelectedId(currId, sendNotificationAsync);
+        else if (numInputs > 0 && (currId < 1 || currId > numInputs))
             inputBox->setSelectedId(1, sendNotificationAsync);
         else
             inputBox->setSelectedId(currId, dontSendNotification);
@@ -256,14 +364,30 @@ void MultiBandIntegratorEditor::updateSettings()
     
 }
 
+void MultiBandIntegratorEditor::channelChanged(int chan, bool newState)
+{
+    // in multi-channel mode, the channel selector picks the channels to integrate
+    if (inputBox->getSelectedId() == MULTI_CHANNEL_ID && !acquisitionIsActive)
+    {
+        MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
+        processor->setIntegratedChannels(getActiveChannels());
+    }
+}
+
 void MultiBandIntegratorEditor::startAcquisition()
 {
     inputBox->setEnabled(false);
+    decimBox->setEnabled(false);
+    kernelBox->setEnabled(false);
+    statsButton->setEnabled(false);
 }
 
 void MultiBandIntegratorEditor::stopAcquisition()
 {
     inputBox->setEnabled(true);
+    decimBox->setEnabled(true);
+    kernelBox->setEnabled(true);
+    statsButton->setEnabled(true);
 }
 
 
@@ -276,20 +400,25 @@ void MultiBandIntegratorEditor::saveCustomParameters(XmlElement* xml)
 
     // channels
     paramValues->setAttribute("inputChanId", inputBox->getSelectedId());
+    paramValues->setAttribute("decimation", decimBox->getSelectedId());
+    paramValues->setAttribute("kernel", kernelBox->getSelectedId());
+    paramValues->setAttribute("statistics", statsButton->getToggleState());
+    paramValues->setAttribute("extraWindows", extraEdit->getText());
+
+    // adaptive threshold
+    paramValues->setAttribute("thresholdLevel", processor->integratorSettings.thresholdLevel);
+    paramValues->setAttribute("thresholdHorizon", processor->integratorSettings.thresholdHorizon);
  
 
-	//frequency bands
-	paramValues->setAttribute("alphaLow", alphaLowEdit->getText());
-	paramValues->setAttribute("alphaHigh", alphaHighEdit->getText());
-	paramValues->setAttribute("betaLow", betaLowEdit->getText());
-	paramValues->setAttribute("betaHigh", betaHighEdit->getText());
-	paramValues->setAttribute("deltaLow", deltaLowEdit->getText());
-	paramValues->setAttribute("deltaHigh", deltaHighEdit->getText());
-
-	// frequency gain
-	paramValues->setAttribute("alphaGain", alphaEditable->getText());
-	paramValues->setAttribute("betaGain", betaEditable->getText());
-	paramValues->setAttribute("deltaGain", deltaEditable->getText());
+	//frequency bands and gains
+	for (int n = 0; n < processor->getNumBands(); n++)
+	{
+		FrequencyBand band = processor->getBand(n);
+		XmlElement* bandValues = paramValues->createNewChildElement("BAND");
+		bandValues->setAttribute("low", band.low);
+		bandValues->setAttribute("high", band.high);
+		bandValues->setAttribute("gain", band.gain);
+	}
 }
 
 void MultiBandIntegratorEditor::loadCustomParameters(XmlElement* xml)
@@ -300,25 +429,92 @@ void MultiBandIntegratorEditor::loadCustomParameters(XmlElement* xml)
     {
         // channels
         inputBox->setSelectedId(xmlNode->getIntAttribute("inputChanId", inputBox->getSelectedId()), sendNotificationAsync);
+        decimBox->setSelectedId(xmlNode->getIntAttribute("decimation", 1), sendNotificationAsync);
+        kernelBox->setSelectedId(xmlNode->getIntAttribute("kernel", ROLLING_ID), sendNotificationAsync);
+        statsButton->setToggleState(xmlNode->getBoolAttribute("statistics", false), sendNotificationSync);
+        extraEdit->setText(xmlNode->getStringAttribute("extraWindows", ""), sendNotificationAsync);
+
+        // adaptive threshold
+        levelEdit->setText(xmlNode->getStringAttribute("thresholdLevel", "0"), sendNotificationAsync);
+        horizonEdit->setText(xmlNode->getStringAttribute("thresholdHorizon", "0"), sendNotificationAsync);
        
-		// frequency bands
-		alphaLowEdit->setText(xmlNode->getStringAttribute("alphaLow", alphaLowEdit->getText()), sendNotificationAsync);
-		alphaHighEdit->setText(xmlNode->getStringAttribute("alphaHigh", alphaHighEdit->getText()), sendNotificationAsync);
-		betaLowEdit->setText(xmlNode->getStringAttribute("betaLow", betaLowEdit->getText()), sendNotificationAsync);
-		betaHighEdit->setText(xmlNode->getStringAttribute("betaHigh", betaHighEdit->getText()), sendNotificationAsync);
-		deltaLowEdit->setText(xmlNode->getStringAttribute("deltaLow", deltaLowEdit->getText()), sendNotificationAsync);
-		deltaHighEdit->setText(xmlNode->getStringAttribute("deltaHigh", deltaHighEdit->getText()), sendNotificationAsync);
-
-		// frequency gains
-		alphaEditable->setText(xmlNode->getStringAttribute("alphaGain", alphaEditable->getText()), sendNotificationAsync);
-		betaEditable->setText(xmlNode->getStringAttribute("betaGain", betaEditable->getText()), sendNotificationAsync);
-		deltaEditable->setText(xmlNode->getStringAttribute("deltaGain", deltaEditable->getText()), sendNotificationAsync);
+		// frequency bands and gains
+		Array<FrequencyBand> loadedBands;
+		forEachXmlChildElementWithTagName(*xmlNode, bandNode, "BAND")
+		{
+			FrequencyBand band;
+			band.low = static_cast<float>(bandNode->getDoubleAttribute("low", 1.0));
+			band.high = static_cast<float>(bandNode->getDoubleAttribute("high", 4.0));
+			band.gain = static_cast<float>(bandNode->getDoubleAttribute("gain", 0.0));
+			loadedBands.add(band);
+		}
+
+		// settings saved before the band table existed have exactly three bands
+		if (loadedBands.isEmpty() && xmlNode->hasAttribute("alphaLow"))
+		{
+			const char* legacyNames[] = { "alpha", "beta", "delta" };
+			for (const char* name : legacyNames)
+			{
+				FrequencyBand band;
+				band.low = static_cast<float>(xmlNode->getDoubleAttribute(String(name) + "Low"));
+				band.high = static_cast<float>(xmlNode->getDoubleAttribute(String(name) + "High"));
+				band.gain = static_cast<float>(xmlNode->getDoubleAttribute(String(name) + "Gain", 1.0));
+				loadedBands.add(band);
+			}
+		}
+
+		if (!loadedBands.isEmpty())
+		{
+			processor->setParameter(pNumBands, static_cast<float>(loadedBands.size()));
+			for (int n = 0; n < loadedBands.size() && n < processor->getNumBands(); n++)
+			{
+				processor->setParameter(bandParam(n, pBandLow), loadedBands[n].low);
+				processor->setParameter(bandParam(n, pBandHigh), loadedBands[n].high);
+				processor->setParameter(bandParam(n, pBandGain), loadedBands[n].gain);
+			}
+			updateBandControls();
+		}
       
         }  
 }
 
 /**************** private ******************/
 
+void MultiBandIntegratorEditor::updateBandControls()
+{
+	MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
+	int numBands = processor->getNumBands();
+
+	int currId = bandBox->getSelectedId();
+	bandBox->clear(dontSendNotification);
+	for (int band = 1; band <= numBands; band++)
+		bandBox->addItem(String(band), band);
+	bandBox->setSelectedId(jlimit(1, numBands, currId), dontSendNotification);
+
+	FrequencyBand band = processor->getBand(getSelectedBand());
+	bandLowEdit->setText(String(band.low), dontSendNotification);
+	bandHighEdit->setText(String(band.high), dontSendNotification);
+	bandGainEdit->setText(String(band.gain), dontSendNotification);
+
+	addBandButton->setEnabled(numBands < MultiBandIntegrator::MAX_BANDS);
+	removeBandButton->setEnabled(numBands > 1);
+}
+
+int MultiBandIntegratorEditor::getSelectedBand() const
+{
+	return jmax(bandBox->getSelectedId() - 1, 0);
+}
+
+String MultiBandIntegratorEditor::getExtraWindowText() const
+{
+    MultiBandIntegrator* processor = static_cast<MultiBandIntegrator*>(getProcessor());
+
+    StringArray durations;
+    for (float duration : processor->integratorSettings.extraRollDurs)
+        durations.add(String(duration));
+    return durations.joinIntoString(", ");
+}
+
 Label* MultiBandIntegratorEditor::createEditable(const String& name, const String& initialValue,
     const String& tooltip, Rectangle bounds)
 {
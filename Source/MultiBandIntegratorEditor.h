@@ -32,10 +32,16 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 
 /*
 Editor (in signal chain) contains:
-- Input channel selector (filtered output will appear on this channel as well)
-- Rolling window duration (ms)
-- Low-cut and High-cut frequencies for 3 frequency bands of interest
-- Gains for each frequency band
+- Input channel selector (filtered output will appear on this channel as well), or "Sel" to integrate
+  every channel selected in the channel selector
+- Rolling window duration (ms), and whether it is averaged by a rolling mean, an exponential average or a
+  cascade of 2 to 4 rolling means
+- Decimation factor ahead of the band filters (1 = off)
+- Band selector with buttons to add and remove frequency bands of interest
+- Low-cut and High-cut frequencies and gain of the selected band
+- Toggle for the rolling statistics of the weighted sum, and durations of extra windows to write the output
+  over (ms, comma-separated; single channel only)
+- Adaptive threshold percentile (0 = off) and horizon (s, 0 = whole session)
 */
 
 
@@ -49,10 +55,12 @@ public:
 	~MultiBandIntegratorEditor();
 	void comboBoxChanged(ComboBox* comboBoxThatHasChanged) override;
 	void labelTextChanged(Label* labelThatHasChanged) override;
+	void buttonEvent(Button* button) override;
 
 	// overrides GenericEditor
 
 	void updateSettings() override;
+	void channelChanged(int chan, bool newState) override;
 
 	// disable input channel selection during acquisition so that events work correctly
 	void startAcquisition() override;
@@ -68,6 +76,15 @@ public:
 private:
 	typedef juce::Rectangle<int> Rectangle;
 
+	// input box item that selects multi-channel mode
+	static const int MULTI_CHANNEL_ID = 10000;
+
+	// kernel box items: the rolling mean, the exponential average, then one item per number of
+	// cascaded stages, with id CASCADE_ID_OFFSET + stages
+	static const int ROLLING_ID = 1;
+	static const int EXPONENTIAL_ID = 2;
+	static const int CASCADE_ID_OFFSET = 1;
+
 	// Basic UI element creation methods. Always register "this" (the editor) as the listener,
 	// but may specify a different Component in which to actually display the element.
 	Label* createEditable(const String& name, const String& initialValue,
@@ -78,35 +95,49 @@ private:
 	static bool updateIntLabel(Label* label, int min, int max, int defaultValue, int* out);
 	static bool updateFloatLabel(Label* label, float min, float max, float defaultValue, float* out);
 
+	// Refreshes the band selector and editables from the processor's band table
+	void updateBandControls();
+	int getSelectedBand() const;
+
+	// the processor's extra window durations, as shown in extraEdit
+	String getExtraWindowText() const;
+
 	ScopedPointer<Label> inputLabel;
 	ScopedPointer<ComboBox> inputBox;
 
-	ScopedPointer<Label> rollLabel1;
+	ScopedPointer<ComboBox> kernelBox;
 	ScopedPointer<Label> rollLabel2;
 	ScopedPointer<Label> rollEdit;
+
+	ScopedPointer<Label> decimLabel;
+	ScopedPointer<ComboBox> decimBox;
 	
 
-	// frequency bandds
+	// frequency bands
 	ScopedPointer<Label> freqLabel;
+	ScopedPointer<Label> bandLabel;
+	ScopedPointer<ComboBox> bandBox;
+	ScopedPointer<UtilityButton> addBandButton;
+	ScopedPointer<UtilityButton> removeBandButton;
+
+	// cutoffs and gain of the selected band
 	ScopedPointer<Label> freqLabelSub;
 	ScopedPointer<Label> freqLabelSub2;
-	
-	ScopedPointer<Label> alphaLowEdit;
-	ScopedPointer<Label> alphaHighEdit;
-	ScopedPointer<Label> betaLowEdit;
-	ScopedPointer<Label> betaHighEdit;
-	ScopedPointer<Label> deltaLowEdit;
-	ScopedPointer<Label> deltaHighEdit;
-
-	// frequency band gains
 	ScopedPointer<Label> gainLabel;
 
-	ScopedPointer<Label> alphaLabel;
-	ScopedPointer<Label> alphaEditable;
-	ScopedPointer<Label> betaLabel;
-	ScopedPointer<Label> betaEditable;
-	ScopedPointer<Label> deltaLabel;
-	ScopedPointer<Label> deltaEditable;
+	ScopedPointer<Label> bandLowEdit;
+	ScopedPointer<Label> bandHighEdit;
+	ScopedPointer<Label> bandGainEdit;
+
+	ScopedPointer<UtilityButton> statsButton;
+	ScopedPointer<Label> extraEdit;
+
+	// adaptive threshold
+	ScopedPointer<Label> thresholdLabel;
+	ScopedPointer<Label> levelLabel;
+	ScopedPointer<Label> levelEdit;
+	ScopedPointer<Label> horizonLabel;
+	ScopedPointer<Label> horizonEdit;
 };
 
 
@@ -0,0 +1,272 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "ProcessTimer.h"
+#include <cstdio>
+
+const char* ProcessTimer::getStageName(Stage stage)
+{
+    switch (stage)
+    {
+    case blockStage:    return "block";
+    case updateStage:   return "update";
+    case kernelStage:   return "kernel";
+    default:            return "?";
+    }
+}
+
+#ifdef MBI_PROFILING
+
+#include <algorithm>    // min
+#include <chrono>
+#include <cmath>        // ldexp, pow
+
+namespace
+{
+    // nanoseconds per tick of ProcessTimer::readTicks(), measured once against the steady clock
+    double measureNsPerTick()
+    {
+#ifdef MBI_HAS_TSC
+        typedef std::chrono::steady_clock Clock;
+
+        const Clock::time_point start = Clock::now();
+        const unsigned long long startTicks = __rdtsc();
+
+        Clock::time_point end;
+        do
+        {
+            end = Clock::now();
+        } while (end - start < std::chrono::milliseconds(20));
+
+        const unsigned long long ticks = __rdtsc() - startTicks;
+        const double ns = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+        return ticks > 0 ? ns / ticks : 1.0;
+#else
+        return 1.0;
+#endif
+    }
+
+    double getNsPerTick()
+    {
+        static const double nsPerTick = measureNsPerTick();
+        return nsPerTick;
+    }
+}
+
+ProcessTimer::ProcessTimer()
+    : nsPerTick (getNsPerTick())
+{
+    sampleRate = 0.0;
+    deadlineFraction = 0.5;
+    reset();
+}
+
+void ProcessTimer::setSampleRate(double newSampleRate)
+{
+    sampleRate.store(newSampleRate, std::memory_order_relaxed);
+}
+
+void ProcessTimer::setDeadlineFraction(double newFraction)
+{
+    deadlineFraction.store(newFraction, std::memory_order_relaxed);
+}
+
+void ProcessTimer::reset()
+{
+    for (int stage = 0; stage < numStages; stage++)
+    {
+        Histogram& h = histograms[stage];
+        h.count = 0;
+        h.totalNs = 0;
+        h.maxNs = 0;
+        for (int bin = 0; bin < numBins; bin++)
+            h.bins[bin] = 0;
+    }
+
+    overruns = 0;
+    worstLoad = 0.0;
+}
+
+int ProcessTimer::getBin(unsigned long long ns)
+{
+    if (ns < binsPerOctave)
+        return static_cast<int>(ns);
+
+    // octave from the highest set bit, then the next two bits pick the bin within it
+    int msb = 0;
+    for (unsigned long long v = ns; v > 1; v >>= 1)
+        msb++;
+
+    const int bin = binsPerOctave * (msb - 1) + static_cast<int>((ns >> (msb - 2)) & (binsPerOctave - 1));
+    return std::min(bin, numBins - 1);
+}
+
+double ProcessTimer::getBinStartNs(int bin)
+{
+    if (bin < binsPerOctave)
+        return bin;
+
+    const int octave = bin / binsPerOctave - 1;
+    return std::ldexp(static_cast<double>(binsPerOctave + bin % binsPerOctave), octave);
+}
+
+// Only the processing thread writes, so plain load / store pairs are enough; they just need to be atomic
+// so that readers never see a torn value.
+void ProcessTimer::record(Stage stage, Ticks elapsed, int nSamples)
+{
+    const unsigned long long ns = static_cast<unsigned long long>(elapsed * nsPerTick);
+    Histogram& h = histograms[stage];
+
+    const int bin = getBin(ns);
+    h.bins[bin].store(h.bins[bin].load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    h.totalNs.store(h.totalNs.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    if (ns > h.maxNs.load(std::memory_order_relaxed))
+        h.maxNs.store(ns, std::memory_order_relaxed);
+
+    // the count goes last, so that a reader sees at least as many binned timings as it counts
+    h.count.store(h.count.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+
+    const double rate = sampleRate.load(std::memory_order_relaxed);
+    if (stage != blockStage || nSamples <= 0 || rate <= 0)
+        return;
+
+    const double load = ns * rate / (nSamples * 1e9);
+    if (load > worstLoad.load(std::memory_order_relaxed))
+        worstLoad.store(load, std::memory_order_relaxed);
+
+    if (load > deadlineFraction.load(std::memory_order_relaxed))
+        overruns.store(overruns.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+ProcessTimer::StageStats ProcessTimer::getStageStats(const Histogram& h) const
+{
+    StageStats stats = {};
+    stats.count = h.count.load(std::memory_order_acquire);
+    if (stats.count == 0)
+        return stats;
+
+    stats.meanNs = static_cast<double>(h.totalNs.load(std::memory_order_relaxed)) / stats.count;
+    stats.maxNs = static_cast<double>(h.maxNs.load(std::memory_order_relaxed));
+
+    // percentiles from the histogram, each reported at its bin's geometric centre (but no more than the maximum)
+    const double fractions[] = { 0.5, 0.99, 0.999 };
+    double* const results[] = { &stats.p50Ns, &stats.p99Ns, &stats.p999Ns };
+    const double binCentre = std::pow(2.0, 0.5 / binsPerOctave);
+
+    for (int p = 0; p < 3; p++)
+    {
+        const double target = fractions[p] * stats.count;
+        unsigned long long seen = 0;
+        int bin = 0;
+        for (; bin < numBins - 1; bin++)
+        {
+            seen += h.bins[bin].load(std::memory_order_relaxed);
+            if (seen >= target)
+                break;
+        }
+
+        const double centre = bin < binsPerOctave ? bin : getBinStartNs(bin) * binCentre;
+        *results[p] = std::min(centre, stats.maxNs);
+    }
+
+    return stats;
+}
+
+ProcessTimer::Stats ProcessTimer::getStats() const
+{
+    Stats stats;
+    for (int stage = 0; stage < numStages; stage++)
+        stats.stages[stage] = getStageStats(histograms[stage]);
+
+    stats.overruns = overruns.load(std::memory_order_relaxed);
+    stats.worstLoad = worstLoad.load(std::memory_order_relaxed);
+    stats.deadlineFraction = deadlineFraction.load(std::memory_order_relaxed);
+    return stats;
+}
+
+bool ProcessTimer::writeReport(const char* path) const
+{
+    FILE* f = std::fopen(path, "w");
+    if (f == nullptr)
+        return false;
+
+    const Stats stats = getStats();
+    const unsigned long long blocks = stats.stages[blockStage].count;
+
+    std::fprintf(f, "Multi-band Integrator timing\n\n");
+    std::fprintf(f, "blocks: %llu\n", blocks);
+    std::fprintf(f, "overruns (over %.0f%% of the block duration): %llu (%.4f%%)\n",
+                 stats.deadlineFraction * 100, stats.overruns, blocks > 0 ? 100.0 * stats.overruns / blocks : 0.0);
+    std::fprintf(f, "worst load: %.1f%% of the block duration\n\n", stats.worstLoad * 100);
+
+    std::fprintf(f, "%-8s %12s %12s %12s %12s %12s %12s\n", "stage", "count", "mean ns", "p50 ns", "p99 ns", "p99.9 ns", "max ns");
+    for (int stage = 0; stage < numStages; stage++)
+    {
+        const StageStats& s = stats.stages[stage];
+        std::fprintf(f, "%-8s %12llu %12.0f %12.0f %12.0f %12.0f %12.0f\n", getStageName(static_cast<Stage>(stage)),
+                     s.count, s.meanNs, s.p50Ns, s.p99Ns, s.p999Ns, s.maxNs);
+    }
+
+    for (int stage = 0; stage < numStages; stage++)
+    {
+        std::fprintf(f, "\n%s histogram (ns from, count):\n", getStageName(static_cast<Stage>(stage)));
+        const Histogram& h = histograms[stage];
+        for (int bin = 0; bin < numBins; bin++)
+        {
+            const unsigned int count = h.bins[bin].load(std::memory_order_relaxed);
+            if (count > 0)
+                std::fprintf(f, "%14.0f %12u\n", getBinStartNs(bin), count);
+        }
+    }
+
+    return std::fclose(f) == 0;
+}
+
+#else
+
+ProcessTimer::ProcessTimer()
+    : deadlineFraction (0.5)
+{}
+
+void ProcessTimer::setSampleRate(double) {}
+
+void ProcessTimer::setDeadlineFraction(double newFraction)
+{
+    deadlineFraction = newFraction;
+}
+
+void ProcessTimer::reset() {}
+
+ProcessTimer::Stats ProcessTimer::getStats() const
+{
+    Stats stats = {};
+    stats.deadlineFraction = deadlineFraction;
+    return stats;
+}
+
+bool ProcessTimer::writeReport(const char*) const
+{
+    return false;
+}
+
+#endif
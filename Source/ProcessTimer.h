@@ -0,0 +1,194 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Timing instrumentation for the audio path.
+// Build with MBI_PROFILING defined to time every processed block, and the stages within it, with the CPU's
+// cycle counter (or the steady clock where there is none). Each stage keeps a histogram of its durations on
+// a logarithmic scale (four bins per octave, so percentiles are within about 10%), along with the count,
+// total and maximum. A block counts as an overrun when it takes longer than a set fraction of the time its
+// samples span in real time.
+// Only the processing thread writes, and each counter is written with a single relaxed atomic store, so
+// recording never locks and any other thread can read the statistics or write a report while processing
+// goes on. A report read during processing may mix counts from two consecutive blocks.
+// Without the define, the timers compile to nothing, getStats() reports no blocks and writeReport() does
+// nothing.
+
+#ifndef PROCESS_TIMER_H_INCLUDED
+#define PROCESS_TIMER_H_INCLUDED
+
+#ifdef MBI_PROFILING
+#include <atomic>
+#if defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64))
+#include <intrin.h>     // __rdtsc
+#define MBI_HAS_TSC
+#elif defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>  // __rdtsc
+#define MBI_HAS_TSC
+#else
+#include <chrono>
+#endif
+#endif
+
+class ProcessTimer
+{
+public:
+    enum Stage
+    {
+        blockStage,     // a whole block, including handing channels to the engine
+        updateStage,    // switching to newly published band coefficients and window length
+        kernelStage,    // the fused filter / sum / integration loop, including reading input and writing output
+        numStages
+    };
+
+    enum
+    {
+        binsPerOctave = 4,
+        numBins = 144   // up to 2^37 ns (over two minutes); longer times go in the last bin
+    };
+
+    struct StageStats
+    {
+        unsigned long long count;
+        double meanNs;
+        double maxNs;
+        double p50Ns;
+        double p99Ns;
+        double p999Ns;
+    };
+
+    struct Stats
+    {
+        StageStats stages[numStages];
+        unsigned long long overruns;    // blocks slower than the deadline
+        double worstLoad;               // longest block time as a fraction of the block's duration
+        double deadlineFraction;
+    };
+
+    ProcessTimer();
+
+    static const char* getStageName(Stage stage);
+
+    // ----- control thread -----
+
+    // sample rate of the processed samples, which sets each block's duration in real time
+    void setSampleRate(double newSampleRate);
+
+    // Blocks taking longer than this fraction of their duration count as overruns (default 0.5).
+    void setDeadlineFraction(double newFraction);
+
+    // clears all statistics; must not be called while processing
+    void reset();
+
+    // may be called at any time, from any thread
+    Stats getStats() const;
+
+    // Writes a readable summary, with each stage's histogram, to the given file.
+    // Returns false if it can't be written or timing isn't compiled in.
+    bool writeReport(const char* path) const;
+
+    // ----- processing thread -----
+
+#ifdef MBI_PROFILING
+    typedef unsigned long long Ticks;
+
+    static Ticks readTicks()
+    {
+#ifdef MBI_HAS_TSC
+        return __rdtsc();
+#else
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+    }
+
+    // adds one timing; for blockStage, nSamples is the block length used for the deadline
+    void record(Stage stage, Ticks elapsed, int nSamples);
+
+private:
+    struct Histogram
+    {
+        std::atomic<unsigned long long> count;
+        std::atomic<unsigned long long> totalNs;
+        std::atomic<unsigned long long> maxNs;
+        std::atomic<unsigned int> bins[numBins];
+    };
+
+    static int getBin(unsigned long long ns);
+    static double getBinStartNs(int bin);
+    StageStats getStageStats(const Histogram& histogram) const;
+
+    const double nsPerTick;
+
+    std::atomic<double> sampleRate;
+    std::atomic<double> deadlineFraction;
+
+    Histogram histograms[numStages];
+    std::atomic<unsigned long long> overruns;
+    std::atomic<double> worstLoad;
+#else
+private:
+    double deadlineFraction;
+#endif
+
+    ProcessTimer(const ProcessTimer&);
+    ProcessTimer& operator=(const ProcessTimer&);
+};
+
+// Times the enclosing scope as one stage. A null timer is ignored.
+class ScopedStageTimer
+{
+public:
+#ifdef MBI_PROFILING
+    ScopedStageTimer(ProcessTimer* timer, ProcessTimer::Stage stage, int nSamples = 0)
+        : timer     (timer)
+        , stage     (stage)
+        , nSamples  (nSamples)
+        , start     (ProcessTimer::readTicks())
+    {}
+
+    ~ScopedStageTimer()
+    {
+        if (timer != nullptr)
+            timer->record(stage, ProcessTimer::readTicks() - start, nSamples);
+    }
+
+    // for a block whose length isn't known at the start of the scope
+    void setNumSamples(int newNumSamples) { nSamples = newNumSamples; }
+
+private:
+    ProcessTimer* const timer;
+    const ProcessTimer::Stage stage;
+    int nSamples;
+    const ProcessTimer::Ticks start;
+#else
+    ScopedStageTimer(ProcessTimer*, ProcessTimer::Stage, int = 0) {}
+    void setNumSamples(int) {}
+
+private:
+#endif
+
+    ScopedStageTimer(const ScopedStageTimer&);
+    ScopedStageTimer& operator=(const ScopedStageTimer&);
+};
+
+#endif
@@ -0,0 +1,162 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "QuantileTracker.h"
+#include <algorithm> // min, max, sort
+
+QuantileTracker::QuantileTracker()
+    : numQuantiles (0)
+    , numMarkers   (0)
+    , count        (0)
+    , horizon      (0)
+{
+    const double median = 0.5;
+    setQuantiles(&median, 1);
+}
+
+void QuantileTracker::setQuantiles(const double* newProbabilities, int newNumQuantiles)
+{
+    numQuantiles = std::min(std::max(newNumQuantiles, 1), static_cast<int>(maxQuantiles));
+    numMarkers = 2 * numQuantiles + 3;
+
+    double p[maxQuantiles];
+    for (int i = 0; i < numQuantiles; i++)
+        p[i] = i < newNumQuantiles ? std::min(std::max(newProbabilities[i], 1e-6), 1.0 - 1e-6) : 0.5;
+    std::sort(p, p + numQuantiles);
+
+    // each quantile's marker with the midpoints on either side of it, between the extremes
+    probabilities[0] = 0.0;
+    double previous = 0.0;
+    for (int i = 0; i < numQuantiles; i++)
+    {
+        probabilities[2 * i + 1] = (previous + p[i]) / 2;
+        probabilities[2 * i + 2] = p[i];
+        previous = p[i];
+    }
+    probabilities[numMarkers - 2] = (previous + 1.0) / 2;
+    probabilities[numMarkers - 1] = 1.0;
+
+    setHorizon(horizon);
+    reset();
+}
+
+void QuantileTracker::setHorizon(double samples)
+{
+    // the markers need room to move apart
+    horizon = samples > 0 ? std::max(samples, 2.0 * numMarkers) : 0.0;
+}
+
+void QuantileTracker::reset()
+{
+    count = 0;
+    for (int i = 0; i < maxMarkers; i++)
+    {
+        heights[i] = 0.0;
+        positions[i] = i + 1.0;
+    }
+}
+
+void QuantileTracker::add(double x)
+{
+    const int last = numMarkers - 1;
+
+    // gather the first samples in sorted order; they become the markers
+    if (count < numMarkers)
+    {
+        int i = static_cast<int>(count);
+        for (; i > 0 && heights[i - 1] > x; i--)
+            heights[i] = heights[i - 1];
+        heights[i] = x;
+        count++;
+        return;
+    }
+
+    // the markers above the new sample move up by one. Comparing with every marker instead of
+    // searching for the sample's cell avoids branches that depend on the data
+    heights[0] = std::min(heights[0], x);
+    heights[last] = std::max(heights[last], x);
+    for (int i = 1; i < last; i++)
+        positions[i] += x < heights[i] ? 1.0 : 0.0;
+    positions[last] += 1.0;
+    count += 1.0;
+
+    if (horizon > 0 && count > horizon)
+    {
+        // count no more than horizon samples: squeeze every position towards the bottom by the same factor
+        const double scale = (horizon - 1.0) / (count - 1.0);
+        for (int i = 1; i <= last; i++)
+            positions[i] = 1.0 + (positions[i] - 1.0) * scale;
+        count = horizon;
+
+        // and forget the extremes at the same rate
+        heights[0] += (heights[1] - heights[0]) / horizon;
+        heights[last] += (heights[last - 1] - heights[last]) / horizon;
+    }
+
+    // move each inner marker that is off by a position or more, if there's room
+    for (int i = 1; i < last; i++)
+    {
+        const double desired = 1.0 + (count - 1.0) * probabilities[i];
+        const double offset = desired - positions[i];
+
+        if ((offset >= 1.0 && positions[i + 1] - positions[i] > 1.0) ||
+            (offset <= -1.0 && positions[i - 1] - positions[i] < -1.0))
+        {
+            const int d = offset > 0 ? 1 : -1;
+            const double height = parabolic(i, d);
+            if (heights[i - 1] < height && height < heights[i + 1])
+                heights[i] = height;
+            else
+                heights[i] = linear(i, d);
+            positions[i] += d;
+        }
+    }
+}
+
+double QuantileTracker::getQuantile(int index) const
+{
+    const int marker = 2 * std::min(std::max(index, 0), numQuantiles - 1) + 2;
+
+    if (count >= numMarkers)
+        return heights[marker];
+    if (count == 0)
+        return 0.0;
+
+    // nearest rank among the samples so far
+    const int rank = static_cast<int>(probabilities[marker] * (count - 1.0) + 0.5);
+    return heights[rank];
+}
+
+double QuantileTracker::parabolic(int i, double d) const
+{
+    const double nBelow = positions[i] - positions[i - 1];
+    const double nAbove = positions[i + 1] - positions[i];
+    return heights[i] + d / (positions[i + 1] - positions[i - 1])
+        * ((nBelow + d) * (heights[i + 1] - heights[i]) / nAbove
+         + (nAbove - d) * (heights[i] - heights[i - 1]) / nBelow);
+}
+
+double QuantileTracker::linear(int i, int d) const
+{
+    return heights[i] + d * (heights[i + d] - heights[i]) / (positions[i + d] - positions[i]);
+}
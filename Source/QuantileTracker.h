@@ -0,0 +1,89 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Running estimate of one or more quantiles of a signal, in constant memory and constant time per
+// sample, without keeping any of the samples. This is the P-square algorithm (Jain & Chlamtac, 1985)
+// in the form extended to several quantiles at once (Raatikainen, 1987): a handful of markers follow
+// the minimum, the maximum, each quantile and the points halfway between them. Each new sample moves
+// the markers' positions, and a marker whose position falls behind or ahead of where it should be is
+// nudged by one, with its height re-estimated by a parabola through it and its neighbours.
+// By default the estimate covers every sample since the last reset. With a horizon of H samples, the
+// markers' positions are scaled down so that they never count more than H samples, which makes older
+// samples count less and less, and the minimum and maximum relax towards their neighbours at the same
+// rate, so that a single outlier is eventually forgotten. The estimate then follows slow drift over
+// about H samples.
+// Everything is stored inline, so the tracker never allocates and can be kept one per channel.
+
+#ifndef QUANTILE_TRACKER_H_INCLUDED
+#define QUANTILE_TRACKER_H_INCLUDED
+
+class QuantileTracker
+{
+public:
+    enum
+    {
+        maxQuantiles = 4
+    };
+
+    // tracks the median until told otherwise
+    QuantileTracker();
+
+    // Sets the probabilities (between 0 and 1, exclusive) of the quantiles to track, up to maxQuantiles
+    // in ascending order, and starts over. Out-of-range or unsorted lists are clamped and sorted.
+    void setQuantiles(const double* probabilities, int numQuantiles);
+    int getNumQuantiles() const { return numQuantiles; }
+    double getProbability(int index) const { return probabilities[2 * index + 2]; }
+
+    // Number of samples over which old samples are forgotten (see above), or 0 to count every sample.
+    // Takes effect from the next sample on, without starting over.
+    void setHorizon(double samples);
+    double getHorizon() const { return horizon; }
+
+    void reset();
+
+    void add(double x);
+
+    // Current estimate of the quantile with the given index. Until there are enough samples for the
+    // markers, it is the nearest-rank quantile of the samples so far; 0 before the first one.
+    double getQuantile(int index) const;
+
+private:
+    enum
+    {
+        maxMarkers = 2 * maxQuantiles + 3
+    };
+
+    // marker height, with its neighbours' positions, after moving it by one position in direction d
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+    int numQuantiles;
+    int numMarkers;
+    double probabilities[maxMarkers];   // of each marker: 0, the quantiles, the points between, 1
+    double heights[maxMarkers];         // the samples so far, sorted, until there are numMarkers of them
+    double positions[maxMarkers];       // 1-based rank of each marker among the samples counted
+    double count;                       // samples counted, at most horizon
+    double horizon;
+};
+
+#endif
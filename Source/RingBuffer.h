@@ -0,0 +1,142 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Fixed-capacity history of frames (one value per channel) for the rolling accumulators.
+// The capacity is rounded up to a power of two, so a position in the ring is found by masking a
+// running frame counter instead of comparing and wrapping an index. The frames start on a cache line.
+// Only allocate() allocates; writing frames and looking back at them never does.
+// The ring keeps the last getCapacity() frames no matter how many of them an accumulator's window
+// currently spans, so a window can be lengthened again without losing the samples in between.
+// Moving a window's start walks the history in between, so a large change in length is spread over
+// several blocks (see stepWindowSize) to keep the work done at the start of any one block bounded.
+
+#ifndef RING_BUFFER_H_INCLUDED
+#define RING_BUFFER_H_INCLUDED
+
+#include <algorithm> // fill, max, min
+#include <cstddef>   // size_t
+#include <cstdint>   // uintptr_t
+#include <vector>
+
+template <typename T>
+class RingBuffer
+{
+public:
+    RingBuffer()
+        : frames   (nullptr)
+        , width    (1)
+        , mask     (0)
+        , position (0)
+        , filled   (0)
+    {
+        allocate(1, 1);
+    }
+
+    // Makes room for at least minCapacity frames of frameWidth values each and clears the history.
+    // Must not be called while processing.
+    void allocate(int minCapacity, int frameWidth)
+    {
+        unsigned int capacity = 1;
+        while (capacity < static_cast<unsigned int>(minCapacity))
+            capacity <<= 1;
+
+        width = frameWidth < 1 ? 1 : frameWidth;
+        mask = capacity - 1;
+
+        // one cache line more than needed, so that the frames can start on a line boundary
+        const size_t size = static_cast<size_t>(capacity) * width;
+        const size_t lineValues = cacheLine / sizeof(T);
+        storage.assign(size + lineValues, T());
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(storage.data());
+        const size_t misalignment = address % cacheLine;
+        frames = storage.data() + (misalignment == 0 ? 0 : (cacheLine - misalignment) / sizeof(T));
+
+        clear();
+    }
+
+    // values of history that a window may walk through at the start of one block when its length changes
+    enum { resizeBudget = 1 << 16 };
+
+    // Window length to use for the next block, on the way from `from` to `to` samples, for a window
+    // whose start costs valuesPerFrame values to move by one frame (e.g. channels x running sums).
+    static int stepWindowSize(int from, int to, int valuesPerFrame)
+    {
+        const int maxStep = std::max(static_cast<int>(resizeBudget) / std::max(valuesPerFrame, 1), 1);
+        return to > from ? std::min(to, from + maxStep) : std::max(to, from - maxStep);
+    }
+
+    int getCapacity() const { return static_cast<int>(mask + 1); }
+    int getWidth() const { return width; }
+
+    // Forgets the history without touching the frames: frames that haven't been written since are
+    // not counted by getNumFilled(), and it is up to the accumulator to treat them as empty.
+    void clear()
+    {
+        position = 0;
+        filled = 0;
+    }
+
+    // frames written since the last clear(), up to getCapacity()
+    int getNumFilled() const { return filled; }
+
+    // the frame that the next push() completes; it holds the frame written getCapacity() frames ago
+    T* getWriteFrame()
+    {
+        return frames + static_cast<size_t>(position & mask) * width;
+    }
+
+    // the frame written age frames ago, 1 <= age <= getCapacity(); age 1 is the most recent one
+    T* getPastFrame(int age)
+    {
+        return frames + static_cast<size_t>((position - static_cast<unsigned int>(age)) & mask) * width;
+    }
+
+    const T* getPastFrame(int age) const
+    {
+        return frames + static_cast<size_t>((position - static_cast<unsigned int>(age)) & mask) * width;
+    }
+
+    // moves on to the next frame, once getWriteFrame() has been filled in
+    void push()
+    {
+        position++;
+        if (filled <= static_cast<int>(mask))
+            filled++;
+    }
+
+private:
+    enum { cacheLine = 64 };
+
+    // not copyable: frames points into storage
+    RingBuffer(const RingBuffer&);
+    RingBuffer& operator=(const RingBuffer&);
+
+    std::vector<T> storage;
+    T* frames;                  // first frame, cache-line aligned within storage
+    int width;
+    unsigned int mask;          // capacity - 1
+    unsigned int position;      // frames written since the last clear(); wraps around harmlessly
+    int filled;
+};
+
+#endif
@@ -0,0 +1,388 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RollingIntegrator.h"
+#include <algorithm> // min, max, fill
+
+RollingLineLength::RollingLineLength()
+    : windowSize          (1)
+    , requestedWindowSize (1)
+    , maxWindowSize       (1)
+    , numChannels         (1)
+    , hasLastSample       (false)
+{
+    prepare(1, 1);
+}
+
+void RollingLineLength::prepare(int newNumChannels, int newMaxWindowSize)
+{
+    numChannels = std::max(newNumChannels, 1);
+    maxWindowSize = std::max(newMaxWindowSize, 1);
+
+    diffs.allocate(maxWindowSize, numChannels);
+    sums.assign(numChannels, 0.0);
+    lastSamples.assign(numChannels, 0.0f);
+    inRow.assign(numChannels, 0.0f);
+    meanRow.assign(numChannels, 0.0f);
+
+    windowSize = std::min(requestedWindowSize.load(), maxWindowSize);
+    requestedWindowSize = windowSize;
+    reset();
+}
+
+void RollingLineLength::setWindowSize(int newWindowSize)
+{
+    requestedWindowSize = std::min(std::max(newWindowSize, 1), maxWindowSize);
+}
+
+void RollingLineLength::reset()
+{
+    std::fill(sums.begin(), sums.end(), 0.0);
+    diffs.clear();
+    hasLastSample = false;
+}
+
+void RollingLineLength::beginBlock()
+{
+    const int newWindowSize = requestedWindowSize.load();
+    if (newWindowSize == windowSize)
+        return;
+
+    resizeWindow(RingBuffer<float>::stepWindowSize(windowSize, newWindowSize, numChannels));
+}
+
+void RollingLineLength::resizeWindow(int newWindowSize)
+{
+    // the differences between the two window starts, as far back as the ring has been filled
+    const bool growing = newWindowSize > windowSize;
+    const int firstAge = std::min(windowSize, newWindowSize) + 1;
+    const int lastAge = std::min(std::max(windowSize, newWindowSize), diffs.getNumFilled());
+    double* const sum = sums.data();
+
+    for (int age = firstAge; age <= lastAge; age++)
+    {
+        const float* const frame = diffs.getPastFrame(age);
+        for (int c = 0; c < numChannels; c++)
+        {
+            if (growing)
+                sum[c] += frame[c];
+            else
+                sum[c] -= frame[c];
+        }
+    }
+
+    windowSize = newWindowSize;
+}
+
+void RollingLineLength::process(const float* const* in, float* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    float* const x = inRow.data();
+    float* const mean = meanRow.data();
+
+    beginBlock();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, mean);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = mean[c];
+    }
+}
+
+MultiWindowLineLength::MultiWindowLineLength()
+    : numWindows    (1)
+    , maxWindowSize (1)
+    , numChannels   (1)
+    , sinceRebase   (0)
+    , hasLastSample (false)
+{
+    for (int w = 0; w < maxWindows; w++)
+    {
+        windowSizes[w] = 1;
+        requestedWindowSizes[w] = 1;
+    }
+
+    prepare(1, 1, 1);
+}
+
+void MultiWindowLineLength::prepare(int newNumChannels, int newMaxWindowSize, int newNumWindows)
+{
+    numChannels = std::max(newNumChannels, 1);
+    maxWindowSize = std::max(newMaxWindowSize, 1);
+    numWindows = std::min(std::max(newNumWindows, 0), static_cast<int>(maxWindows));
+
+    totals.allocate(maxWindowSize + 1, numChannels);
+    current.assign(numChannels, 0.0);
+    origins.assign(numChannels, 0.0);
+    shifts.assign(numChannels, 0.0);
+    lastSamples.assign(numChannels, 0.0f);
+    inRow.assign(numChannels, 0.0f);
+    meanRows.assign(static_cast<size_t>(maxWindows) * numChannels, 0.0f);
+
+    for (int w = 0; w < maxWindows; w++)
+    {
+        windowSizes[w] = std::min(requestedWindowSizes[w].load(), maxWindowSize);
+        requestedWindowSizes[w] = windowSizes[w];
+    }
+    reset();
+}
+
+void MultiWindowLineLength::setWindowSize(int window, int newWindowSize)
+{
+    if (window >= 0 && window < maxWindows)
+        requestedWindowSizes[window] = std::min(std::max(newWindowSize, 1), maxWindowSize);
+}
+
+void MultiWindowLineLength::reset()
+{
+    std::fill(current.begin(), current.end(), 0.0);
+    std::fill(origins.begin(), origins.end(), 0.0);
+    std::fill(shifts.begin(), shifts.end(), 0.0);
+    totals.clear();
+    sinceRebase = 0;
+    hasLastSample = false;
+}
+
+void MultiWindowLineLength::beginBlock()
+{
+    for (int w = 0; w < numWindows; w++)
+        windowSizes[w] = requestedWindowSizes[w].load();
+}
+
+void MultiWindowLineLength::rebase()
+{
+    // the totals in the ring keep their old base until the next lap overwrites them; processFrame
+    // takes the shift off those it reads, which comes to the same as subtracting it here
+    for (int c = 0; c < numChannels; c++)
+    {
+        shifts[c] = current[c];
+        origins[c] -= current[c];
+        current[c] = 0.0;
+    }
+
+    sinceRebase = 0;
+}
+
+void MultiWindowLineLength::process(const float* const* in, float* const* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    float* const x = inRow.data();
+    float* const means = meanRows.data();
+
+    beginBlock();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, means);
+
+        for (int w = 0; w < numWindows; w++)
+        {
+            for (int c = 0; c < nChans; c++)
+                out[w][c][i] = means[w * nChans + c];
+        }
+    }
+}
+
+const double ExponentialLineLength::minAverage = 1e-30;
+
+ExponentialLineLength::ExponentialLineLength()
+    : windowSize          (1)
+    , requestedWindowSize (1)
+    , alpha               (1.0)
+    , numChannels         (1)
+    , hasLastSample       (false)
+{
+    prepare(1);
+}
+
+void ExponentialLineLength::prepare(int newNumChannels)
+{
+    numChannels = std::max(newNumChannels, 1);
+
+    averages.assign(numChannels, 0.0);
+    lastSamples.assign(numChannels, 0.0f);
+    inRow.assign(numChannels, 0.0f);
+    meanRow.assign(numChannels, 0.0f);
+
+    windowSize = 0;     // picks up the requested size below
+    beginBlock();
+    reset();
+}
+
+void ExponentialLineLength::setWindowSize(int newWindowSize)
+{
+    requestedWindowSize = std::max(newWindowSize, 1);
+}
+
+void ExponentialLineLength::reset()
+{
+    std::fill(averages.begin(), averages.end(), 0.0);
+    hasLastSample = false;
+}
+
+void ExponentialLineLength::beginBlock()
+{
+    const int newWindowSize = requestedWindowSize.load();
+    if (newWindowSize == windowSize)
+        return;
+
+    // the average carries on from where it is, just with a different time constant
+    windowSize = newWindowSize;
+    alpha = 2.0 / (windowSize + 1);
+}
+
+void ExponentialLineLength::process(const float* const* in, float* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    float* const x = inRow.data();
+    float* const mean = meanRow.data();
+
+    beginBlock();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, mean);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = mean[c];
+    }
+}
+
+CascadedLineLength::CascadedLineLength()
+    : stageLength         (1)
+    , requestedWindowSize (1)
+    , maxWindowSize       (1)
+    , numStages           (minStages)
+    , numChannels         (1)
+    , hasLastSample       (false)
+{
+    prepare(1, 1, minStages);
+}
+
+void CascadedLineLength::prepare(int newNumChannels, int newMaxWindowSize, int newNumStages)
+{
+    numChannels = std::max(newNumChannels, 1);
+    maxWindowSize = std::max(newMaxWindowSize, 1);
+    numStages = std::min(std::max(newNumStages, static_cast<int>(minStages)), static_cast<int>(maxStages));
+
+    // stages that aren't in use only take up a single frame
+    const int maxStageLength = getStageLength(maxWindowSize);
+    for (int stage = 0; stage < maxStages; stage++)
+        inputs[stage].allocate(stage < numStages ? maxStageLength : 1, numChannels);
+
+    sums.assign(static_cast<size_t>(maxStages) * numChannels, 0.0);
+    lastSamples.assign(numChannels, 0.0f);
+    inRow.assign(numChannels, 0.0f);
+    meanRow.assign(numChannels, 0.0f);
+
+    requestedWindowSize = std::min(requestedWindowSize.load(), maxWindowSize);
+    stageLength = getStageLength(requestedWindowSize.load());
+    reset();
+}
+
+int CascadedLineLength::getStageLength(int newWindowSize) const
+{
+    return std::max((newWindowSize + numStages / 2) / numStages, 1);
+}
+
+void CascadedLineLength::setWindowSize(int newWindowSize)
+{
+    requestedWindowSize = std::min(std::max(newWindowSize, 1), maxWindowSize);
+}
+
+void CascadedLineLength::reset()
+{
+    std::fill(sums.begin(), sums.end(), 0.0);
+    for (int stage = 0; stage < maxStages; stage++)
+        inputs[stage].clear();
+    hasLastSample = false;
+}
+
+void CascadedLineLength::beginBlock()
+{
+    const int newStageLength = getStageLength(requestedWindowSize.load());
+    if (newStageLength == stageLength)
+        return;
+
+    // every stage walks the same ages, so the budget is shared between them
+    resizeStages(RingBuffer<float>::stepWindowSize(stageLength, newStageLength, numStages * numChannels));
+}
+
+void CascadedLineLength::resizeStages(int newStageLength)
+{
+    const bool growing = newStageLength > stageLength;
+
+    for (int stage = 0; stage < numStages; stage++)
+    {
+        // the inputs between the two window starts, as far back as the ring has been filled
+        const RingBuffer<float>& ring = inputs[stage];
+        const int firstAge = std::min(stageLength, newStageLength) + 1;
+        const int lastAge = std::min(std::max(stageLength, newStageLength), ring.getNumFilled());
+        double* const sum = sums.data() + stage * numChannels;
+
+        for (int age = firstAge; age <= lastAge; age++)
+        {
+            const float* const frame = ring.getPastFrame(age);
+            for (int c = 0; c < numChannels; c++)
+            {
+                if (growing)
+                    sum[c] += frame[c];
+                else
+                    sum[c] -= frame[c];
+            }
+        }
+    }
+
+    stageLength = newStageLength;
+}
+
+void CascadedLineLength::process(const float* const* in, float* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    float* const x = inRow.data();
+    float* const mean = meanRow.data();
+
+    beginBlock();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, mean);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = mean[c];
+    }
+}
@@ -0,0 +1,441 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Rolling line-length integrator used by the multi-band integrator.
+// The output at each sample is the mean of |x[n] - x[n-1]| over the last windowSize samples.
+// The ring of differences, the running sum and the last input sample persist across calls to
+// process(), so each new sample costs the same amount of work regardless of the window length.
+// Like the zero-filled rollBuffer it replaces, the window starts out full of zeros.
+// Any number of channels can be integrated together. All channels share the ring position and
+// their differences are interleaved in the ring, [slot][channel], so that each step in time
+// updates all channels with one loop over a contiguous row.
+// The ring (see RingBuffer) is allocated once by prepare() for the longest window that will be used,
+// and always keeps that many differences. Changing the window length after that only takes effect at
+// the start of the next block (see beginBlock), can be done from another thread while processing, and
+// never allocates. The history is kept: a longer window takes back the older differences still in
+// the ring, a shorter one drops its oldest ones, so the output carries on without starting over.
+// Taking back or dropping differences is done a bounded number at a time, so a large change glides to
+// the new length over several blocks (at most RingBuffer::resizeBudget values per block).
+// Clearing the history doesn't touch the ring either: slots that haven't been written since the last
+// clear are simply counted as zero.
+//
+// MultiWindowLineLength computes the same mean over several window lengths at once (e.g. a short one
+// for onsets and longer ones for confirmation and burden). Instead of a ring of differences and a
+// running sum per window, it keeps one ring of prefix sums (the total of all differences so far, as it
+// stood at each past sample), so that each window's sum is the current total minus the total one
+// window ago: one subtraction per window and sample, whatever the lengths. Since the totals only grow,
+// they are rebased to zero once every lap of the ring, which keeps their rounding error as small as
+// that of a window's worth of differences however long the session runs. Rebasing doesn't rewrite the
+// ring: the totals of the lap before are taken down by the last rebase's shift as they are read, since
+// no window reaches back further than that.
+//
+// ExponentialLineLength and CascadedLineLength average the same differences with other kernels, chosen
+// with the same window length. ExponentialLineLength is a single-pole average whose samples have the
+// same mean age as those of the rolling window (smoothing factor 2 / (windowSize + 1)). It only keeps a
+// running average per channel, so it needs no ring at all. CascadedLineLength runs the differences
+// through 2 to maxStages rolling means in a row (as in a CIC filter), each windowSize / stages long.
+// The cascade spans the same time as the one rolling window, with the same memory. Its response
+// rises and falls smoothly, close to a Gaussian, instead of jumping when a burst enters or leaves the
+// window. Each stage keeps its history when the window length changes, just like RollingLineLength.
+
+#ifndef ROLLING_INTEGRATOR_H_INCLUDED
+#define ROLLING_INTEGRATOR_H_INCLUDED
+
+#include "RingBuffer.h"
+#include <algorithm> // max
+#include <atomic>
+#include <cmath>  // fabs
+#include <vector>
+
+class RollingLineLength
+{
+public:
+    RollingLineLength();
+
+    // allocates the ring for windows of up to maxWindowSize samples and clears the history.
+    // must not be called while processing
+    void prepare(int newNumChannels, int newMaxWindowSize);
+    int getNumChannels() const { return numChannels; }
+    int getMaxWindowSize() const { return maxWindowSize; }
+
+    // Changes the window length (in samples, limited to getMaxWindowSize()). The new length takes
+    // effect from the start of the next block, with the history kept; a large change is reached over
+    // several blocks. Safe to call while processing.
+    void setWindowSize(int newWindowSize);
+    int getWindowSize() const { return requestedWindowSize.load(); }
+
+    // clears the history; must not be called while processing
+    void reset();
+
+    // moves the window towards a pending new length; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; in[c] and out[c] may point to the same buffer
+    void process(const float* const* in, float* const* out, int nSamples);
+
+    // single-channel convenience, for use when getNumChannels() == 1
+    void process(const float* in, float* out, int nSamples)
+    {
+        process(&in, &out, nSamples);
+    }
+
+    // advances every channel by one sample: x[c] is channel c's input, mean[c] receives its rolling mean.
+    // Defined inline so that fused kernels (see IntegratorEngine) can run it inside their own sample loop,
+    // after calling beginBlock().
+    inline void processFrame(const float* x, float* mean);
+
+private:
+    // moves the start of the window to newWindowSize differences back, adding or dropping the ones in between
+    void resizeWindow(int newWindowSize);
+
+    int windowSize;                 // in use by the processing thread
+    std::atomic<int> requestedWindowSize;
+    int maxWindowSize;
+    int numChannels;
+
+    RingBuffer<float> diffs;        // the last maxWindowSize or more absolute differences, [slot][channel];
+                                    // those not written since the history was cleared count as zero
+
+    std::vector<double> sums;       // running sum of each channel's differences in the ring
+    std::vector<float> lastSamples;
+    bool hasLastSample;
+
+    // one value per channel for the current time step
+    std::vector<float> inRow;
+    std::vector<float> meanRow;
+};
+
+inline void RollingLineLength::processFrame(const float* x, float* mean)
+{
+    const int nChans = numChannels;
+    const double count = static_cast<double>(windowSize);
+    const bool windowFull = diffs.getNumFilled() >= windowSize;
+    double* const sum = sums.data();
+    float* const last = lastSamples.data();
+    const float* const oldest = diffs.getPastFrame(windowSize);
+    float* const slot = diffs.getWriteFrame();    // may be the same frame as oldest
+
+    for (int c = 0; c < nChans; c++)
+    {
+        const float diff = hasLastSample ? std::fabs(x[c] - last[c]) : 0.0f;
+        last[c] = x[c];
+
+        // same update order as boost's rolling_sum: drop the oldest difference, then add the new one
+        if (windowFull)
+            sum[c] -= oldest[c];
+        sum[c] += diff;
+        slot[c] = diff;
+
+        mean[c] = static_cast<float>(sum[c] / count);
+    }
+
+    hasLastSample = true;
+    diffs.push();
+}
+
+class MultiWindowLineLength
+{
+public:
+    enum { maxWindows = 8 };
+
+    MultiWindowLineLength();
+
+    // allocates the ring for numWindows windows of up to maxWindowSize samples (and at most
+    // maxWindows of them) and clears the history. Must not be called while processing
+    void prepare(int newNumChannels, int newMaxWindowSize, int newNumWindows);
+    int getNumChannels() const { return numChannels; }
+    int getMaxWindowSize() const { return maxWindowSize; }
+    int getNumWindows() const { return numWindows; }
+
+    // Changes the length of one window (in samples, limited to getMaxWindowSize()). Takes effect at
+    // the start of the next block; as every window reads the same history, nothing else changes.
+    // Safe to call while processing.
+    void setWindowSize(int window, int newWindowSize);
+    int getWindowSize(int window) const { return requestedWindowSizes[window].load(); }
+
+    // clears the history; must not be called while processing
+    void reset();
+
+    // applies pending window size changes; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; out[w][c] receives the rolling mean of channel c over window w
+    void process(const float* const* in, float* const* const* out, int nSamples);
+
+    // advances every channel by one sample: x[c] is channel c's input and means[w * getNumChannels() + c]
+    // receives its rolling mean over window w. Defined inline so that fused kernels (see IntegratorEngine)
+    // can run it inside their own sample loop, after calling beginBlock().
+    inline void processFrame(const float* x, float* means);
+
+private:
+    // starts a new lap with each channel's total at zero
+    void rebase();
+
+    int windowSizes[maxWindows];    // in use by the processing thread
+    std::atomic<int> requestedWindowSizes[maxWindows];
+    int numWindows;
+    int maxWindowSize;
+    int numChannels;
+
+    RingBuffer<double> totals;      // each channel's total of differences after each past sample, [slot][channel]
+    std::vector<double> current;    // each channel's total now
+    std::vector<double> origins;    // each channel's total when the history was cleared; earlier samples count as zero
+    std::vector<double> shifts;     // each channel's total at the last rebase, which the totals of the lap before
+                                    // it are still relative to
+    int sinceRebase;                // samples written in the current lap
+
+    std::vector<float> lastSamples;
+    bool hasLastSample;
+
+    // one value per channel (and window) for the current time step
+    std::vector<float> inRow;
+    std::vector<float> meanRows;
+};
+
+inline void MultiWindowLineLength::processFrame(const float* x, float* means)
+{
+    const int nChans = numChannels;
+    const int filled = totals.getNumFilled();
+    double* const total = current.data();
+    float* const last = lastSamples.data();
+
+    for (int c = 0; c < nChans; c++)
+    {
+        const float diff = hasLastSample ? std::fabs(x[c] - last[c]) : 0.0f;
+        last[c] = x[c];
+        total[c] += diff;
+    }
+
+    // each window's sum is the total now less the total as it stood a window ago. The ring is one frame
+    // longer than the longest window, so that frame is never the one about to be overwritten
+    for (int w = 0; w < numWindows; w++)
+    {
+        const int windowSize = windowSizes[w];
+        const double* const start = windowSize <= filled ? totals.getPastFrame(windowSize) : origins.data();
+        const double count = static_cast<double>(windowSize);
+        float* const mean = means + w * nChans;
+
+        // divided like RollingLineLength, so that both give the same mean for the same window
+        if (windowSize <= sinceRebase || windowSize > filled)
+        {
+            for (int c = 0; c < nChans; c++)
+                mean[c] = static_cast<float>((total[c] - start[c]) / count);
+        }
+        else
+        {
+            // the window starts in the lap before the last rebase
+            const double* const shift = shifts.data();
+            for (int c = 0; c < nChans; c++)
+                mean[c] = static_cast<float>((total[c] - (start[c] - shift[c])) / count);
+        }
+    }
+
+    double* const slot = totals.getWriteFrame();
+    for (int c = 0; c < nChans; c++)
+        slot[c] = total[c];
+
+    hasLastSample = true;
+    totals.push();
+
+    if (++sinceRebase == totals.getCapacity())
+        rebase();
+}
+
+class ExponentialLineLength
+{
+public:
+    ExponentialLineLength();
+
+    // clears the history; must not be called while processing
+    void prepare(int newNumChannels);
+    int getNumChannels() const { return numChannels; }
+
+    // Changes the length of the rolling window (in samples) that the average stands in for. Takes
+    // effect at the start of the next block. Safe to call while processing.
+    void setWindowSize(int newWindowSize);
+    int getWindowSize() const { return requestedWindowSize.load(); }
+
+    // clears the history; must not be called while processing
+    void reset();
+
+    // applies a pending window size change; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; in[c] and out[c] may point to the same buffer
+    void process(const float* const* in, float* const* out, int nSamples);
+
+    // single-channel convenience, for use when getNumChannels() == 1
+    void process(const float* in, float* out, int nSamples)
+    {
+        process(&in, &out, nSamples);
+    }
+
+    // advances every channel by one sample: x[c] is channel c's input, mean[c] receives its average.
+    // Defined inline so that fused kernels (see IntegratorEngine) can run it inside their own sample loop,
+    // after calling beginBlock().
+    inline void processFrame(const float* x, float* mean);
+
+private:
+    static const double minAverage;
+
+    int windowSize;                 // in use by the processing thread
+    std::atomic<int> requestedWindowSize;
+    double alpha;                   // smoothing factor for windowSize
+    int numChannels;
+
+    std::vector<double> averages;
+    std::vector<float> lastSamples;
+    bool hasLastSample;
+
+    // one value per channel for the current time step
+    std::vector<float> inRow;
+    std::vector<float> meanRow;
+};
+
+inline void ExponentialLineLength::processFrame(const float* x, float* mean)
+{
+    const int nChans = numChannels;
+    const double a = alpha;
+    double* const average = averages.data();
+    float* const last = lastSamples.data();
+
+    for (int c = 0; c < nChans; c++)
+    {
+        const float diff = hasLastSample ? std::fabs(x[c] - last[c]) : 0.0f;
+        last[c] = x[c];
+
+        // a flat input would otherwise run the average down into denormals and stay there
+        average[c] = std::max(average[c] + a * (diff - average[c]), minAverage);
+        mean[c] = static_cast<float>(average[c]);
+    }
+
+    hasLastSample = true;
+}
+
+class CascadedLineLength
+{
+public:
+    enum
+    {
+        minStages = 2,
+        maxStages = 4
+    };
+
+    CascadedLineLength();
+
+    // allocates one ring per stage for windows of up to maxWindowSize samples in all and clears the
+    // history. must not be called while processing
+    void prepare(int newNumChannels, int newMaxWindowSize, int newNumStages);
+    int getNumChannels() const { return numChannels; }
+    int getMaxWindowSize() const { return maxWindowSize; }
+    int getNumStages() const { return numStages; }
+
+    // Changes the length of the whole cascade (in samples, limited to getMaxWindowSize()), which is
+    // split evenly between the stages. Takes effect at the start of the next block, with the history
+    // kept; a large change is reached over several blocks. Safe to call while processing.
+    void setWindowSize(int newWindowSize);
+    int getWindowSize() const { return requestedWindowSize.load(); }
+
+    // clears the history; must not be called while processing
+    void reset();
+
+    // moves the stages towards a pending new length; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; in[c] and out[c] may point to the same buffer
+    void process(const float* const* in, float* const* out, int nSamples);
+
+    // single-channel convenience, for use when getNumChannels() == 1
+    void process(const float* in, float* out, int nSamples)
+    {
+        process(&in, &out, nSamples);
+    }
+
+    // advances every channel by one sample: x[c] is channel c's input, mean[c] receives the cascade's output.
+    // Defined inline so that fused kernels (see IntegratorEngine) can run it inside their own sample loop,
+    // after calling beginBlock().
+    inline void processFrame(const float* x, float* mean);
+
+private:
+    // samples in each stage for a cascade of windowSize samples
+    int getStageLength(int windowSize) const;
+
+    // moves the start of every stage's window to newStageLength inputs back, as in RollingLineLength
+    void resizeStages(int newStageLength);
+
+    int stageLength;                // in use by the processing thread
+    std::atomic<int> requestedWindowSize;
+    int maxWindowSize;
+    int numStages;
+    int numChannels;
+
+    RingBuffer<float> inputs[maxStages];    // the last inputs to each stage, [slot][channel];
+                                            // those not written since the history was cleared count as zero
+    std::vector<double> sums;       // running sum of each stage's inputs in its window, [stage][channel]
+    std::vector<float> lastSamples;
+    bool hasLastSample;
+
+    // one value per channel for the current time step
+    std::vector<float> inRow;
+    std::vector<float> meanRow;
+};
+
+inline void CascadedLineLength::processFrame(const float* x, float* mean)
+{
+    const int nChans = numChannels;
+    const int length = stageLength;
+    const double scale = 1.0 / length;
+    float* const last = lastSamples.data();
+
+    // mean holds each stage's input and is overwritten with its output
+    for (int c = 0; c < nChans; c++)
+    {
+        mean[c] = hasLastSample ? std::fabs(x[c] - last[c]) : 0.0f;
+        last[c] = x[c];
+    }
+
+    for (int stage = 0; stage < numStages; stage++)
+    {
+        RingBuffer<float>& ring = inputs[stage];
+        const bool windowFull = ring.getNumFilled() >= length;
+        double* const sum = sums.data() + stage * nChans;
+        const float* const oldest = ring.getPastFrame(length);
+        float* const slot = ring.getWriteFrame();     // may be the same frame as oldest
+
+        for (int c = 0; c < nChans; c++)
+        {
+            if (windowFull)
+                sum[c] -= oldest[c];
+            sum[c] += mean[c];
+            slot[c] = mean[c];
+
+            mean[c] = static_cast<float>(sum[c] * scale);
+        }
+
+        ring.push();
+    }
+
+    hasLastSample = true;
+}
+
+#endif
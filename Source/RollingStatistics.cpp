@@ -0,0 +1,114 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+#include "RollingStatistics.h"
+#include <algorithm> // min, max
+
+RollingStatistics::RollingStatistics()
+    : windowSize          (1)
+    , requestedWindowSize (1)
+    , maxWindowSize       (1)
+    , numChannels         (1)
+{
+    prepare(1, 1);
+}
+
+void RollingStatistics::prepare(int newNumChannels, int newMaxWindowSize)
+{
+    numChannels = std::max(newNumChannels, 1);
+    maxWindowSize = std::max(newMaxWindowSize, 1);
+
+    samples.allocate(maxWindowSize, numChannels);
+    sums.resize(numChannels);
+    inRow.assign(numChannels, 0.0f);
+    momentsRow.resize(numChannels);
+
+    windowSize = std::min(requestedWindowSize.load(), maxWindowSize);
+    requestedWindowSize = windowSize;
+    reset();
+}
+
+void RollingStatistics::setWindowSize(int newWindowSize)
+{
+    requestedWindowSize = std::min(std::max(newWindowSize, 1), maxWindowSize);
+}
+
+void RollingStatistics::reset()
+{
+    const PowerSums zero = {};
+    std::fill(sums.begin(), sums.end(), zero);
+    samples.clear();
+}
+
+void RollingStatistics::beginBlock()
+{
+    const int newWindowSize = requestedWindowSize.load();
+    if (newWindowSize == windowSize)
+        return;
+
+    // each channel keeps four running sums, each a sample's worth of work to move
+    resizeWindow(RingBuffer<float>::stepWindowSize(windowSize, newWindowSize, 4 * numChannels));
+}
+
+void RollingStatistics::resizeWindow(int newWindowSize)
+{
+    // the samples between the two window starts, as far back as the ring has been filled
+    const bool growing = newWindowSize > windowSize;
+    const int firstAge = std::min(windowSize, newWindowSize) + 1;
+    const int lastAge = std::min(std::max(windowSize, newWindowSize), samples.getNumFilled());
+    PowerSums* const sum = sums.data();
+
+    for (int age = firstAge; age <= lastAge; age++)
+    {
+        const float* const frame = samples.getPastFrame(age);
+        for (int c = 0; c < numChannels; c++)
+        {
+            if (growing)
+                sum[c].add(frame[c]);
+            else
+                sum[c].remove(frame[c]);
+        }
+    }
+
+    windowSize = newWindowSize;
+}
+
+void RollingStatistics::process(const float* const* in, Moments* const* out, int nSamples)
+{
+    const int nChans = numChannels;
+    float* const x = inRow.data();
+    Moments* const moments = momentsRow.data();
+
+    beginBlock();
+
+    for (int i = 0; i < nSamples; i++)
+    {
+        for (int c = 0; c < nChans; c++)
+            x[c] = in[c][i];
+
+        processFrame(x, moments);
+
+        for (int c = 0; c < nChans; c++)
+            out[c][i] = moments[c];
+    }
+}
@@ -0,0 +1,199 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Rolling statistics of a signal: mean, variance, RMS, skewness and kurtosis over the last windowSize
+// samples, all from one window.
+// A single ring holds the samples in the window, and running sums of their first to fourth powers are
+// updated as each new sample enters and the oldest leaves, so every sample costs the same amount of
+// work regardless of the window length, and all five statistics come from the same four sums. The
+// sums are compensated (TwoSum) so that the rounding errors of adding and dropping samples don't
+// build up over hours of processing.
+// Unlike RollingLineLength, the window doesn't start out full of zeros: until windowSize samples have
+// been seen, the statistics are those of the samples so far.
+// The layout and threading follow RollingLineLength: channels are interleaved in the ring,
+// [slot][channel], the ring is allocated once by prepare() for the longest window that will be used,
+// and window changes can be requested from another thread and take effect at the start of the next
+// block, keeping the history. A large change is reached over several blocks, as in RollingLineLength.
+
+#ifndef ROLLING_STATISTICS_H_INCLUDED
+#define ROLLING_STATISTICS_H_INCLUDED
+
+#include "RingBuffer.h"
+#include <atomic>
+#include <cmath>  // sqrt
+#include <vector>
+
+class RollingStatistics
+{
+public:
+    // statistics of one channel's window. Variance and the moments are those of the population
+    // (divided by the number of samples); kurtosis is not in excess, i.e. 3 for Gaussian noise.
+    // Skewness and kurtosis are 0 while the window holds a constant.
+    struct Moments
+    {
+        float mean;
+        float variance;
+        float rms;
+        float skewness;
+        float kurtosis;
+    };
+
+    RollingStatistics();
+
+    // allocates the ring for windows of up to maxWindowSize samples and clears the history.
+    // must not be called while processing
+    void prepare(int newNumChannels, int newMaxWindowSize);
+    int getNumChannels() const { return numChannels; }
+    int getMaxWindowSize() const { return maxWindowSize; }
+
+    // Changes the window length (in samples, limited to getMaxWindowSize()). The new length takes
+    // effect from the start of the next block, with the history kept; a large change is reached over
+    // several blocks. Safe to call while processing.
+    void setWindowSize(int newWindowSize);
+    int getWindowSize() const { return requestedWindowSize.load(); }
+
+    // clears the history; must not be called while processing
+    void reset();
+
+    // moves the window towards a pending new length; call at the start of each block
+    void beginBlock();
+
+    // processes getNumChannels() channels; out[c] receives nSamples statistics of channel c
+    void process(const float* const* in, Moments* const* out, int nSamples);
+
+    // advances every channel by one sample: x[c] is channel c's input, moments[c] receives its statistics.
+    // Defined inline so that fused kernels (see IntegratorEngine) can run it inside their own sample loop,
+    // after calling beginBlock().
+    inline void processFrame(const float* x, Moments* moments);
+
+private:
+    // a running sum that keeps the rounding error of each addition (Knuth's TwoSum, which unlike
+    // Neumaier's version needs no branch) and adds them up separately
+    struct Sum
+    {
+        double sum;
+        double compensation;
+
+        void add(double x)
+        {
+            const double t = sum + x;
+            const double z = t - sum;
+            compensation += (sum - (t - z)) + (x - z);
+            sum = t;
+        }
+
+        double get() const { return sum + compensation; }
+    };
+
+    // running sums of x, x^2, x^3 and x^4 over the window. A sample's powers are computed the same
+    // way when it enters the window and when it leaves, so that only the summation rounds, and the
+    // compensation takes care of that.
+    struct PowerSums
+    {
+        Sum s[4];
+
+        void add(double x)
+        {
+            const double x2 = x * x;
+            s[0].add(x);
+            s[1].add(x2);
+            s[2].add(x2 * x);
+            s[3].add(x2 * x2);
+        }
+
+        void remove(double x)
+        {
+            const double x2 = x * x;
+            s[0].add(-x);
+            s[1].add(-x2);
+            s[2].add(-(x2 * x));
+            s[3].add(-(x2 * x2));
+        }
+    };
+
+    // moves the start of the window to newWindowSize samples back, adding or dropping the ones in between
+    void resizeWindow(int newWindowSize);
+
+    int windowSize;                 // in use by the processing thread
+    std::atomic<int> requestedWindowSize;
+    int maxWindowSize;
+    int numChannels;
+
+    RingBuffer<float> samples;      // the last maxWindowSize or more samples, [slot][channel]
+
+    std::vector<PowerSums> sums;    // one per channel
+
+    // one value per channel for the current time step
+    std::vector<float> inRow;
+    std::vector<Moments> momentsRow;
+};
+
+inline void RollingStatistics::processFrame(const float* x, Moments* moments)
+{
+    const int nChans = numChannels;
+    const int filled = samples.getNumFilled();
+    const bool windowFull = filled >= windowSize;
+    const double invCount = 1.0 / (windowFull ? windowSize : filled + 1);
+    PowerSums* const sum = sums.data();
+    const float* const oldest = samples.getPastFrame(windowSize);
+    float* const slot = samples.getWriteFrame();  // may be the same frame as oldest
+
+    for (int c = 0; c < nChans; c++)
+    {
+        if (windowFull)
+            sum[c].remove(oldest[c]);
+        sum[c].add(x[c]);
+        slot[c] = x[c];
+
+        const Sum* const s = sum[c].s;
+
+        // raw moments about zero, then central moments
+        const double r1 = s[0].get() * invCount;
+        const double r2 = s[1].get() * invCount;
+        const double r3 = s[2].get() * invCount;
+        const double r4 = s[3].get() * invCount;
+        const double mean2 = r1 * r1;
+        const double m2 = r2 - mean2;
+        const double m3 = r3 - 3.0 * r1 * r2 + 2.0 * mean2 * r1;
+        const double m4 = r4 - 4.0 * r1 * r3 + 6.0 * mean2 * r2 - 3.0 * mean2 * mean2;
+
+        Moments& out = moments[c];
+        out.mean = static_cast<float>(r1);
+        out.variance = static_cast<float>(m2 > 0.0 ? m2 : 0.0);
+        out.rms = static_cast<float>(std::sqrt(r2 > 0.0 ? r2 : 0.0));
+        if (m2 > 1e-12 * r2)
+        {
+            out.skewness = static_cast<float>(m3 / (m2 * std::sqrt(m2)));
+            out.kurtosis = static_cast<float>(m4 / (m2 * m2));
+        }
+        else
+        {
+            out.skewness = 0.0f;
+            out.kurtosis = 0.0f;
+        }
+    }
+
+    samples.push();
+}
+
+#endif
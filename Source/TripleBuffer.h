@@ -0,0 +1,84 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Lock-free handoff of a value from one writer thread to one reader thread.
+// The writer fills the back slot and publishes it; the reader picks up the most recently published
+// slot whenever it is ready to (e.g. at the start of a block). Neither side ever waits for the other
+// or allocates. If the writer publishes several times before the reader looks, the reader only sees
+// the last one. T must be copy-assignable and is stored inline, so keep it to plain fixed-size data.
+
+#ifndef TRIPLE_BUFFER_H_INCLUDED
+#define TRIPLE_BUFFER_H_INCLUDED
+
+#include <atomic>
+
+template <typename T>
+class TripleBuffer
+{
+public:
+    TripleBuffer()
+        : back    (0)
+        , front   (1)
+        , mailbox (2)
+    {}
+
+    // writer: the slot to fill in before calling publish()
+    T& getBack() { return slots[back]; }
+
+    // writer: hands the back slot to the reader and takes over an unused one
+    void publish()
+    {
+        back = mailbox.exchange(back | freshBit) & indexMask;
+    }
+
+    // reader: switches to the most recently published slot, if there is a new one.
+    // returns true if the front slot changed.
+    bool update()
+    {
+        if ((mailbox.load() & freshBit) == 0)
+            return false;
+
+        front = mailbox.exchange(front) & indexMask;
+        return true;
+    }
+
+    // reader: the slot currently in use
+    const T& getFront() const { return slots[front]; }
+
+    // Sets every slot to the same value. Only safe while the reader is not running.
+    void fill(const T& value)
+    {
+        for (int i = 0; i < 3; i++)
+            slots[i] = value;
+    }
+
+private:
+    enum { indexMask = 3, freshBit = 4 };
+
+    T slots[3];
+    int back;                   // owned by the writer
+    int front;                  // owned by the reader
+    std::atomic<int> mailbox;   // slot in transit, plus freshBit if the reader hasn't taken it yet
+};
+
+#endif
@@ -0,0 +1,1141 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Throughput and block latency benchmark for the integrator's signal path and the vendored Dsp library.
+// Each stage is run over synthetic data while one parameter at a time (block size, sample rate,
+// window length, band count, channel count, decimation) is swept around a baseline configuration.
+// Results are printed as a table and optionally written as JSON for tracking across builds.
+//
+// Stages:
+//   engine            IntegratorEngine::process, i.e. everything MultiBandIntegrator::process does
+//                     apart from picking channels out of the host's buffer
+//   engine_outputs    the same with every optional output (raw input, band sum, rolling statistics,
+//                     three extra windows) and the adaptive threshold after it. The window switches
+//                     between its configured length and the longest allowed every 50 blocks
+//   band_filter       MultiBandFilter::process (all bands and the weighted sum)
+//   dsp_band_filters  the same bands as one Dsp::SmoothedFilterDesign per band and channel, summed
+//                     through per-band buffers, as the plugin used to do; kept as a reference
+//   dsp_vector_filters  as dsp_band_filters, but with one filter per band for all channels, using
+//                     Dsp::DirectFormIIVector state (channels processed together in SIMD lanes)
+//   rolling_mean      RollingLineLength::process
+//   exponential_mean  ExponentialLineLength::process, the same window as a single-pole average
+//   cascaded_mean     CascadedLineLength::process, the same window as four rolling means in a row
+//   adaptive_threshold  AdaptiveThreshold::process, following the 99th percentile over a 10 s horizon
+//
+// Separately, the denormal policies of the Dsp states (see Dsp/Denormal.h) are compared on quiet inputs:
+// speed, and the largest deviation from an exact (unprotected, no flushing) run of the same filter.
+// The offline filters are checked against references on a 1-4 Hz band at 30 kHz: SegmentedFilter on
+// eight threads against one, and ZeroPhaseFilter against its forward and backward passes in long
+// double. The run fails if either is further off than its bound.
+//
+// `make check` builds mbi-bench-alloc with MBI_ALLOCATION_CHECK (see AllocationCheck.h) and runs every
+// stage through every sweep with it. Each block is processed inside a ScopedNoAllocation, so the run
+// aborts if any stage touches the heap while processing. It also fails if an offline filter is off.
+
+#include "IntegratorSettings.h"
+#include "AllocationCheck.h"
+#include "Dsp/Dsp.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <unistd.h> // gethostname
+
+namespace
+{
+    struct Config
+    {
+        Config()
+            : sampleRate  (30000)
+            , blockSize   (1024)
+            , rollDur     (1000)
+            , numBands    (3)
+            , numChannels (1)
+            , decimation  (1)
+        {}
+
+        int sampleRate;
+        int blockSize;
+        float rollDur;      // ms
+        int numBands;
+        int numChannels;
+        int decimation;
+    };
+
+    struct Result
+    {
+        std::string stage;
+        std::string sweep;      // parameter varied from the baseline, or "baseline"
+        Config config;
+        long long samples;      // channel-samples processed while timing
+        double seconds;
+        double p50, p99, p999;  // block latency (ns)
+    };
+
+    // Something to run block by block. Implementations own all of their buffers.
+    class Stage
+    {
+    public:
+        virtual ~Stage() {}
+        virtual void processBlock(int nSamples) = 0;
+    };
+
+    // Input and output buffers for one block of each channel, refilled with fresh noise from a
+    // longer pregenerated signal so that the filters don't see the same block over and over.
+    class TestSignal
+    {
+    public:
+        TestSignal(const Config& config)
+            : numChannels (config.numChannels)
+            , blockSize   (config.blockSize)
+            , position    (0)
+        {
+            std::mt19937 rng(1);
+            std::normal_distribution<float> noise(0.0f, 50.0f);
+            source.resize(static_cast<size_t>(config.sampleRate));
+            for (float& x : source)
+                x = noise(rng);
+
+            data.resize(static_cast<size_t>(blockSize) * numChannels);
+            for (int c = 0; c < numChannels; c++)
+                channels.push_back(&data[static_cast<size_t>(c) * blockSize]);
+        }
+
+        // copies the next stretch of the source into every channel (not timed)
+        void refill()
+        {
+            for (int c = 0; c < numChannels; c++)
+            {
+                for (int i = 0; i < blockSize; i++)
+                    channels[c][i] = source[(position + i + c * 97) % source.size()];
+            }
+            position = (position + blockSize) % source.size();
+        }
+
+        float* const* get() { return channels.data(); }
+
+    private:
+        int numChannels;
+        int blockSize;
+        size_t position;
+        std::vector<float> source;
+        std::vector<float> data;
+        std::vector<float*> channels;
+    };
+
+    IntegratorSettings makeSettings(const Config& config)
+    {
+        IntegratorSettings settings;
+        settings.rollDur = config.rollDur;
+        settings.decimation = config.decimation;
+
+        // bands spread over 1-40 Hz, so that any of them fit any decimation factor at 1 kHz and up
+        settings.bands.clear();
+        for (int n = 0; n < config.numBands; n++)
+        {
+            float low = 1.0f + n * 2.5f;
+            FrequencyBand band = { low, low + 2.0f, 1.0f };
+            settings.bands.push_back(band);
+        }
+        return settings;
+    }
+
+    class EngineStage : public Stage
+    {
+    public:
+        EngineStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            makeSettings(config).applyTo(engine, config.numChannels, config.sampleRate);
+        }
+
+        void processBlock(int nSamples) override
+        {
+            engine.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        IntegratorEngine engine;
+    };
+
+    class EngineOutputsStage : public Stage
+    {
+    public:
+        EngineOutputsStage(const Config& config, TestSignal& signal)
+            : signal     (signal)
+            , numChannels (config.numChannels)
+            , numBlocks  (0)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            settings.extraRollDurs.push_back(250);
+            settings.extraRollDurs.push_back(2000);
+            settings.extraRollDurs.push_back(5000);
+            settings.thresholdLevel = 99;
+            settings.thresholdHorizon = 10;
+
+            settings.applyTo(engine, numChannels, config.sampleRate);
+            engine.setStatisticsEnabled(true);
+            threshold.prepare(numChannels);
+            settings.applyThreshold(threshold, config.sampleRate);
+
+            shortWindow = settings.getWindowSize(config.sampleRate);
+            longWindow = settings.getMaxWindowSize(config.sampleRate);
+
+            const int numWindows = engine.getNumExtraWindows();
+            const size_t channelSamples = static_cast<size_t>(numChannels) * config.blockSize;
+            rawData.resize(channelSamples);
+            sumData.resize(channelSamples);
+            thresholdData.resize(channelSamples);
+            statsData.resize(channelSamples);
+            windowData.resize(channelSamples * numWindows);
+
+            for (int c = 0; c < numChannels; c++)
+            {
+                const size_t offset = static_cast<size_t>(c) * config.blockSize;
+                rawChannels.push_back(&rawData[offset]);
+                sumChannels.push_back(&sumData[offset]);
+                thresholdChannels.push_back(&thresholdData[offset]);
+                statsChannels.push_back(&statsData[offset]);
+            }
+
+            for (int w = 0; w < numWindows; w++)
+            {
+                for (int c = 0; c < numChannels; c++)
+                    windowChannels.push_back(&windowData[(static_cast<size_t>(w) * numChannels + c) * config.blockSize]);
+            }
+            for (int w = 0; w < numWindows; w++)
+                windows.push_back(&windowChannels[static_cast<size_t>(w) * numChannels]);
+        }
+
+        void processBlock(int nSamples) override
+        {
+            if (++numBlocks % 50 == 0)
+                engine.setWindowSize((numBlocks / 50) % 2 != 0 ? longWindow : shortWindow);
+
+            engine.process(signal.get(), signal.get(), nSamples, rawChannels.data(), sumChannels.data(),
+                           statsChannels.data(), windows.data());
+            threshold.process(signal.get(), thresholdChannels.data(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        int numChannels;
+        int numBlocks;
+        int shortWindow;
+        int longWindow;
+        IntegratorEngine engine;
+        AdaptiveThreshold threshold;
+
+        std::vector<float> rawData, sumData, thresholdData, windowData;
+        std::vector<RollingStatistics::Moments> statsData;
+        std::vector<float*> rawChannels, sumChannels, thresholdChannels, windowChannels;
+        std::vector<RollingStatistics::Moments*> statsChannels;
+        std::vector<float* const*> windows;
+    };
+
+    class BandFilterStage : public Stage
+    {
+    public:
+        BandFilterStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            filter.setNumChannels(config.numChannels);
+            filter.setNumBands(config.numBands);
+            filter.setSampleRate(config.sampleRate);
+            for (int n = 0; n < config.numBands; n++)
+                filter.setBand(n, settings.bands[n].low, settings.bands[n].high, settings.bands[n].gain);
+            filter.publish();
+        }
+
+        void processBlock(int nSamples) override
+        {
+            filter.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        MultiBandFilter filter;
+    };
+
+    class DspBandFiltersStage : public Stage
+    {
+    public:
+        typedef Dsp::SmoothedFilterDesign<Dsp::Butterworth::Design::BandPass<2>, 1, Dsp::DirectFormII> BandFilter;
+
+        DspBandFiltersStage(const Config& config, TestSignal& signal)
+            : signal      (signal)
+            , numChannels (config.numChannels)
+            , numBands    (config.numBands)
+            , bandBuffer  (config.blockSize)
+            , sum         (config.blockSize)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            for (int i = 0; i < numChannels * numBands; i++)
+            {
+                const FrequencyBand& b = settings.bands[i % numBands];
+                Dsp::Params params;
+                params[0] = config.sampleRate;
+                params[1] = 2;
+                params[2] = (b.high + b.low) / 2;
+                params[3] = b.high - b.low;
+
+                filters.push_back(new BandFilter(1));
+                filters.back()->setParams(params);
+                gains.push_back(b.gain);
+            }
+        }
+
+        ~DspBandFiltersStage()
+        {
+            for (BandFilter* f : filters)
+                delete f;
+        }
+
+        void processBlock(int nSamples) override
+        {
+            float* const* channels = signal.get();
+            float* band = bandBuffer.data();
+
+            for (int c = 0; c < numChannels; c++)
+            {
+                float* x = channels[c];
+                std::fill(sum.begin(), sum.begin() + nSamples, 0.0f);
+
+                for (int n = 0; n < numBands; n++)
+                {
+                    std::memcpy(band, x, nSamples * sizeof(float));
+                    filters[c * numBands + n]->process(nSamples, &band);
+
+                    const float gain = gains[c * numBands + n];
+                    for (int i = 0; i < nSamples; i++)
+                        sum[i] += gain * band[i];
+                }
+
+                std::memcpy(x, sum.data(), nSamples * sizeof(float));
+            }
+        }
+
+    private:
+        TestSignal& signal;
+        int numChannels;
+        int numBands;
+        std::vector<BandFilter*> filters;   // [channel][band]
+        std::vector<float> gains;
+        std::vector<float> bandBuffer;
+        std::vector<float> sum;
+    };
+
+    template <int Channels>
+    class DspVectorFiltersStage : public Stage
+    {
+    public:
+        typedef Dsp::SmoothedFilterDesign<Dsp::Butterworth::Design::BandPass<2>, Channels,
+                                          Dsp::DirectFormIIVector> BandFilter;
+
+        DspVectorFiltersStage(const Config& config, TestSignal& signal)
+            : signal      (signal)
+            , numBands    (config.numBands)
+            , bandData    (static_cast<size_t>(config.blockSize) * Channels)
+            , sumData     (bandData.size())
+        {
+            IntegratorSettings settings = makeSettings(config);
+            for (int n = 0; n < numBands; n++)
+            {
+                const FrequencyBand& b = settings.bands[n];
+                Dsp::Params params;
+                params[0] = config.sampleRate;
+                params[1] = 2;
+                params[2] = (b.high + b.low) / 2;
+                params[3] = b.high - b.low;
+
+                filters.push_back(new BandFilter(1));
+                filters.back()->setParams(params);
+                gains.push_back(b.gain);
+            }
+
+            for (int c = 0; c < Channels; c++)
+                bandChannels[c] = &bandData[static_cast<size_t>(c) * config.blockSize];
+        }
+
+        ~DspVectorFiltersStage()
+        {
+            for (BandFilter* f : filters)
+                delete f;
+        }
+
+        void processBlock(int nSamples) override
+        {
+            float* const* channels = signal.get();
+            std::fill(sumData.begin(), sumData.end(), 0.0f);
+
+            for (int n = 0; n < numBands; n++)
+            {
+                for (int c = 0; c < Channels; c++)
+                    std::memcpy(bandChannels[c], channels[c], nSamples * sizeof(float));
+
+                filters[n]->process(nSamples, bandChannels);
+
+                const float gain = gains[n];
+                for (int c = 0; c < Channels; c++)
+                {
+                    float* sum = &sumData[static_cast<size_t>(c) * nSamples];
+                    for (int i = 0; i < nSamples; i++)
+                        sum[i] += gain * bandChannels[c][i];
+                }
+            }
+
+            for (int c = 0; c < Channels; c++)
+                std::memcpy(channels[c], &sumData[static_cast<size_t>(c) * nSamples], nSamples * sizeof(float));
+        }
+
+    private:
+        TestSignal& signal;
+        int numBands;
+        std::vector<BandFilter*> filters;
+        std::vector<float> gains;
+        std::vector<float> bandData;
+        std::vector<float> sumData;
+        float* bandChannels[Channels];
+    };
+
+    class RollingMeanStage : public Stage
+    {
+    public:
+        RollingMeanStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            rolling.prepare(config.numChannels, settings.getWindowSize(config.sampleRate));
+            rolling.setWindowSize(settings.getWindowSize(config.sampleRate));
+        }
+
+        void processBlock(int nSamples) override
+        {
+            rolling.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        RollingLineLength rolling;
+    };
+
+    class ExponentialMeanStage : public Stage
+    {
+    public:
+        ExponentialMeanStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            exponential.prepare(config.numChannels);
+            exponential.setWindowSize(settings.getWindowSize(config.sampleRate));
+        }
+
+        void processBlock(int nSamples) override
+        {
+            exponential.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        ExponentialLineLength exponential;
+    };
+
+    class CascadedMeanStage : public Stage
+    {
+    public:
+        CascadedMeanStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            cascaded.prepare(config.numChannels, settings.getWindowSize(config.sampleRate),
+                             CascadedLineLength::maxStages);
+            cascaded.setWindowSize(settings.getWindowSize(config.sampleRate));
+        }
+
+        void processBlock(int nSamples) override
+        {
+            cascaded.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        CascadedLineLength cascaded;
+    };
+
+    class AdaptiveThresholdStage : public Stage
+    {
+    public:
+        AdaptiveThresholdStage(const Config& config, TestSignal& signal)
+            : signal (signal)
+        {
+            IntegratorSettings settings = makeSettings(config);
+            settings.thresholdLevel = 99;
+            settings.thresholdHorizon = 10;
+            threshold.prepare(config.numChannels);
+            settings.applyThreshold(threshold, config.sampleRate);
+        }
+
+        void processBlock(int nSamples) override
+        {
+            threshold.process(signal.get(), signal.get(), nSamples);
+        }
+
+    private:
+        TestSignal& signal;
+        AdaptiveThreshold threshold;
+    };
+
+    Stage* createStage(const std::string& name, const Config& config, TestSignal& signal)
+    {
+        if (name == "engine")
+            return new EngineStage(config, signal);
+        if (name == "engine_outputs")
+            return new EngineOutputsStage(config, signal);
+        if (name == "band_filter")
+            return new BandFilterStage(config, signal);
+        if (name == "dsp_band_filters")
+            return new DspBandFiltersStage(config, signal);
+        if (name == "rolling_mean")
+            return new RollingMeanStage(config, signal);
+        if (name == "exponential_mean")
+            return new ExponentialMeanStage(config, signal);
+        if (name == "cascaded_mean")
+            return new CascadedMeanStage(config, signal);
+        if (name == "adaptive_threshold")
+            return new AdaptiveThresholdStage(config, signal);
+
+        // the channel count is part of the filter's type; only the counts swept below are built
+        if (name == "dsp_vector_filters")
+        {
+            switch (config.numChannels)
+            {
+            case 1:  return new DspVectorFiltersStage<1>(config, signal);
+            case 4:  return new DspVectorFiltersStage<4>(config, signal);
+            case 16: return new DspVectorFiltersStage<16>(config, signal);
+            case 64: return new DspVectorFiltersStage<64>(config, signal);
+            default: return nullptr;
+            }
+        }
+        return nullptr;
+    }
+
+    // ----- denormal policies -----
+
+    struct DenormalResult
+    {
+        std::string policy;
+        std::string input;
+        double nsPerSample;
+        double maxError;        // largest deviation from the exact output
+    };
+
+    // Quiet inputs for a 1-4 Hz band at 30 kHz, in which an unprotected filter runs into denormals.
+    // "decay":  a channel gone flat after its last activity has faded to 1e-300. The state decays on
+    //           through the denormal range, where Direct Form II gets stuck in a tiny limit cycle.
+    // "floor":  noise at 1e-3 uV, a channel with next to no signal. Nothing becomes denormal, so
+    //           this shows what the offsets of the dither policies do to such a signal.
+    std::vector<double> makeQuietInput(const std::string& name, int numSamples)
+    {
+        std::mt19937 rng(2);
+        std::vector<double> x(numSamples, 0.0);
+        if (name == "decay")
+        {
+            std::normal_distribution<double> noise(0.0, 1e-300);
+            for (int i = 0; i < numSamples / 100; i++)
+                x[i] = noise(rng);
+        }
+        else
+        {
+            std::normal_distribution<double> noise(0.0, 1e-3);
+            for (double& v : x)
+                v = noise(rng);
+        }
+        return x;
+    }
+
+    template <class Policy>
+    DenormalResult runDenormalPolicy(const char* policyName, const std::string& inputName,
+                                     const std::vector<double>& input, const std::vector<double>& exact)
+    {
+        typedef Dsp::SimpleFilter<Dsp::Butterworth::BandPass<2>, 1,
+                                  Dsp::DenormalForm<Dsp::DirectFormII, Policy> > Filter;
+
+        Filter filter;
+        filter.setup(2, 30000, 2.5, 3);
+
+        const int blockSize = 1024;
+        const int numSamples = static_cast<int>(input.size()) / blockSize * blockSize;
+        std::vector<double> data(input.begin(), input.begin() + numSamples);
+
+        const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (int i = 0; i < numSamples; i += blockSize)
+        {
+            double* block = &data[i];
+            filter.process(blockSize, &block);
+        }
+        const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+        DenormalResult result;
+        result.policy = policyName;
+        result.input = inputName;
+        result.nsPerSample = std::chrono::duration<double, std::nano>(end - start).count() / numSamples;
+        result.maxError = 0;
+        for (int i = 0; i < numSamples; i++)
+            result.maxError = std::max(result.maxError, std::abs(data[i] - exact[i]));
+        return result;
+    }
+
+    std::vector<DenormalResult> runDenormalPolicies(double dataSeconds)
+    {
+        std::printf("\n%-13s %-6s %8s %10s\n", "denormals", "input", "ns/samp", "max error");
+
+        const int numSamples = static_cast<int>(dataSeconds * 30000) / 1024 * 1024 + 1024;
+        const char* inputNames[] = { "decay", "floor" };
+
+        std::vector<DenormalResult> results;
+        for (const char* inputName : inputNames)
+        {
+            const std::vector<double> input = makeQuietInput(inputName, numSamples);
+
+            // the exact output, denormals and all
+            Dsp::SimpleFilter<Dsp::Butterworth::BandPass<2>, 1,
+                              Dsp::DenormalForm<Dsp::DirectFormII, Dsp::DenormalNone> > reference;
+            reference.setup(2, 30000, 2.5, 3);
+            std::vector<double> exact(input);
+            double* channel = exact.data();
+            reference.process(numSamples, &channel);
+
+            results.push_back(runDenormalPolicy<Dsp::DenormalAC>("ac", inputName, input, exact));
+            results.push_back(runDenormalPolicy<Dsp::DenormalDC>("dc", inputName, input, exact));
+            results.push_back(runDenormalPolicy<Dsp::DenormalNone>("none", inputName, input, exact));
+            results.push_back(runDenormalPolicy<Dsp::DenormalFlushToZero>("flush_to_zero", inputName,
+                                                                          input, exact));
+        }
+
+        for (const DenormalResult& r : results)
+            std::printf("%-13s %-6s %8.2f %10.3g\n", r.policy.c_str(), r.input.c_str(), r.nsPerSample, r.maxError);
+        std::fflush(stdout);
+        return results;
+    }
+
+    // ----- offline filters -----
+
+    // SegmentedFilter and ZeroPhaseFilter only run offline, so they are checked for accuracy rather
+    // than timed per block: each against a reference, as a fraction of the reference's peak amplitude.
+    struct OfflineFilterResult
+    {
+        std::string filter;
+        std::string reference;
+        double nsPerSample;
+        double maxError;        // largest deviation from the reference, relative to its peak
+        double bound;           // largest deviation that counts as correct
+    };
+
+    // the 1-4 Hz band at 30 kHz, whose Direct Form II sections lose the most precision
+    typedef Dsp::Butterworth::Design::BandPass<2> OfflineDesign;
+
+    void setupOfflineDesign(OfflineDesign& design)
+    {
+        Dsp::Params params;
+        params[0] = 30000;
+        params[1] = 2;
+        params[2] = 2.5;
+        params[3] = 3;
+        design.setParams(params);
+    }
+
+    // a slow rhythm in the band, line noise and broadband noise
+    std::vector<double> makeOfflineInput(size_t numSamples)
+    {
+        std::mt19937 rng(3);
+        std::normal_distribution<double> noise(0.0, 10.0);
+        std::vector<double> x(numSamples);
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            const double t = i / 30000.0;
+            x[i] = 100 * std::sin(2 * M_PI * 2.5 * t) + 20 * std::sin(2 * M_PI * 60 * t) + noise(rng);
+        }
+        return x;
+    }
+
+    double relativeError(const std::vector<double>& result, const std::vector<long double>& reference)
+    {
+        long double peak = 0;
+        long double error = 0;
+        for (size_t i = 0; i < reference.size(); i++)
+        {
+            peak = std::max(peak, std::fabs(reference[i]));
+            error = std::max(error, std::fabs(result[i] - reference[i]));
+        }
+        return peak > 0 ? static_cast<double>(error / peak) : 0.0;
+    }
+
+    // Runs x through the design's sections in long double, Direct Form I, from the steady state for a
+    // constant input equal to x[0] (or from rest). Independent of the Dsp states, for a reference.
+    void filterReference(OfflineDesign& design, std::vector<long double>& x, bool fromSteadyState)
+    {
+        long double in = fromSteadyState && !x.empty() ? x[0] : 0;
+        for (int k = 0; k < Dsp::getDesignNumStages(design); k++)
+        {
+            const Dsp::BiquadBase& s = Dsp::getDesignStage(design, k);
+            const long double a0 = s.getA0();
+            const long double b0 = s.getB0() / a0, b1 = s.getB1() / a0, b2 = s.getB2() / a0;
+            const long double a1 = s.getA1() / a0, a2 = s.getA2() / a0;
+
+            const long double out = in * (b0 + b1 + b2) / (1 + a1 + a2);
+            long double x1 = in, x2 = in, y1 = out, y2 = out;
+            in = out;
+
+            for (long double& v : x)
+            {
+                const long double y = b0 * v + b1 * x1 + b2 * x2 - a1 * y1 - a2 * y2;
+                x2 = x1;
+                x1 = v;
+                y2 = y1;
+                y1 = y;
+                v = y;
+            }
+        }
+    }
+
+    std::vector<OfflineFilterResult> runOfflineFilters(double dataSeconds)
+    {
+        std::printf("\n%-15s %-11s %8s %10s %10s\n", "offline_filter", "reference", "ns/samp", "max error", "bound");
+
+        // long enough for eight segments
+        const int numThreads = 8;
+        const size_t numSamples = std::max(static_cast<size_t>(dataSeconds * 30000),
+                                           static_cast<size_t>(numThreads) * Dsp::SegmentedFilter::minSegmentLength);
+        const std::vector<double> input = makeOfflineInput(numSamples);
+
+        OfflineDesign design;
+        setupOfflineDesign(design);
+
+        std::vector<OfflineFilterResult> results;
+
+        // several threads against one. The header puts each within 1.5e-8 of the exact result for this
+        // band, so they can't be further apart than twice that
+        {
+            Dsp::SegmentedFilter filter;
+            filter.setup(design);
+
+            filter.setNumThreads(1);
+            std::vector<double> serial(input);
+            filter.process(numSamples, serial.data());
+
+            filter.setNumThreads(numThreads);
+            std::vector<double> parallel(input);
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            filter.process(numSamples, parallel.data());
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            OfflineFilterResult result;
+            result.filter = "segmented";
+            result.reference = "1_thread";
+            result.nsPerSample = std::chrono::duration<double, std::nano>(end - start).count() / numSamples;
+            result.maxError = relativeError(parallel, std::vector<long double>(serial.begin(), serial.end()));
+            result.bound = 3e-8;
+            results.push_back(result);
+        }
+
+        // forwards and backwards against the same passes in long double, over the same padding. Each
+        // pass loses about as much as one run of SegmentedFilter, so the same bound applies
+        {
+            Dsp::ZeroPhaseFilter filter;
+            filter.setup(design);
+            const size_t pad = filter.getPadLength();
+
+            std::vector<double> output(input);
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            filter.process(numSamples, output.data());
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            std::vector<long double> extended;
+            for (size_t i = pad; i > 0; i--)
+                extended.push_back(2.0L * input[0] - input[i]);
+            extended.insert(extended.end(), input.begin(), input.end());
+            for (size_t i = 1; i <= pad; i++)
+                extended.push_back(2.0L * input[numSamples - 1] - input[numSamples - 1 - i]);
+
+            filterReference(design, extended, true);
+            std::reverse(extended.begin(), extended.end());
+            filterReference(design, extended, true);
+            std::reverse(extended.begin(), extended.end());
+
+            OfflineFilterResult result;
+            result.filter = "zero_phase";
+            result.reference = "long_double";
+            result.nsPerSample = std::chrono::duration<double, std::nano>(end - start).count() / numSamples;
+            result.maxError = relativeError(output, std::vector<long double>(extended.begin() + pad,
+                                                                             extended.begin() + pad + numSamples));
+            result.bound = 3e-8;
+            results.push_back(result);
+        }
+
+        for (const OfflineFilterResult& r : results)
+            std::printf("%-15s %-11s %8.2f %10.3g %10.3g%s\n", r.filter.c_str(), r.reference.c_str(), r.nsPerSample,
+                        r.maxError, r.bound, r.maxError <= r.bound ? "" : "  FAILED");
+        std::fflush(stdout);
+        return results;
+    }
+
+    double percentile(const std::vector<double>& sorted, double p)
+    {
+        size_t index = static_cast<size_t>(p * (sorted.size() - 1) + 0.5);
+        return sorted[std::min(index, sorted.size() - 1)];
+    }
+
+    // returns false if the stage can't be built for this configuration
+    bool run(const std::string& stageName, const std::string& sweep, const Config& config, double dataSeconds,
+             Result& result)
+    {
+        TestSignal signal(config);
+        Stage* stage = createStage(stageName, config, signal);
+        if (stage == nullptr)
+            return false;
+
+        // process at least dataSeconds of signal and at least 200 blocks, after 20 blocks of warm-up
+        const long long minSamples = static_cast<long long>(dataSeconds * config.sampleRate);
+        const int numBlocks = static_cast<int>(std::max<long long>(200, minSamples / config.blockSize));
+        const int warmup = 20;
+
+        std::vector<double> latencies;
+        latencies.reserve(numBlocks);
+        double total = 0;
+
+        for (int b = 0; b < warmup + numBlocks; b++)
+        {
+            signal.refill();
+
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            {
+                // aborts on any heap use in builds with MBI_ALLOCATION_CHECK
+                const ScopedNoAllocation noAllocation;
+                stage->processBlock(config.blockSize);
+            }
+            const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+
+            if (b >= warmup)
+            {
+                const double ns = std::chrono::duration<double, std::nano>(end - start).count();
+                latencies.push_back(ns);
+                total += ns;
+            }
+        }
+
+        delete stage;
+        std::sort(latencies.begin(), latencies.end());
+
+        result.stage = stageName;
+        result.sweep = sweep;
+        result.config = config;
+        result.samples = static_cast<long long>(numBlocks) * config.blockSize * config.numChannels;
+        result.seconds = total * 1e-9;
+        result.p50 = percentile(latencies, 0.5);
+        result.p99 = percentile(latencies, 0.99);
+        result.p999 = percentile(latencies, 0.999);
+        return true;
+    }
+
+    void printResult(const Result& r)
+    {
+        const Config& c = r.config;
+        std::printf("%-18s %-11s %6d %6d %6.0f %3d %4d %4d %10.3g %8.2f %10.0f %10.0f %10.0f\n",
+                    r.stage.c_str(), r.sweep.c_str(), c.sampleRate, c.blockSize, c.rollDur, c.numBands,
+                    c.numChannels, c.decimation, r.samples / r.seconds, r.seconds * 1e9 / r.samples,
+                    r.p50, r.p99, r.p999);
+        std::fflush(stdout);
+    }
+
+    // s as a JSON string literal, quotes included
+    std::string jsonString(const std::string& s)
+    {
+        std::string quoted = "\"";
+        for (size_t i = 0; i < s.size(); i++)
+        {
+            const unsigned char ch = static_cast<unsigned char>(s[i]);
+            if (ch == '"' || ch == '\\')
+            {
+                quoted += '\\';
+                quoted += static_cast<char>(ch);
+            }
+            else if (ch < 0x20)
+            {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", ch);
+                quoted += escaped;
+            }
+            else
+            {
+                quoted += static_cast<char>(ch);
+            }
+        }
+        return quoted + "\"";
+    }
+
+    // value printed with format, or null if it isn't finite (JSON has no inf or nan)
+    std::string jsonNumber(double value, const char* format)
+    {
+        if (!std::isfinite(value))
+            return "null";
+
+        char printed[64];
+        std::snprintf(printed, sizeof(printed), format, value);
+        return printed;
+    }
+
+    void writeJson(FILE* f, const std::vector<Result>& results, const std::vector<DenormalResult>& denormals,
+                   const std::vector<OfflineFilterResult>& offlineFilters, const std::string& label)
+    {
+        char host[256] = "";
+        gethostname(host, sizeof(host) - 1);
+
+        char date[64] = "";
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        std::fprintf(f, "{\n");
+        std::fprintf(f, "  \"label\": %s,\n", jsonString(label).c_str());
+        std::fprintf(f, "  \"host\": %s,\n", jsonString(host).c_str());
+        std::fprintf(f, "  \"date\": %s,\n", jsonString(date).c_str());
+        std::fprintf(f, "  \"compiler\": %s,\n", jsonString(__VERSION__).c_str());
+        std::fprintf(f, "  \"results\": [\n");
+
+        for (size_t i = 0; i < results.size(); i++)
+        {
+            const Result& r = results[i];
+            const Config& c = r.config;
+            std::fprintf(f, "    {\"stage\": %s, \"sweep\": %s, \"sample_rate\": %d, \"block_size\": %d, "
+                            "\"window_ms\": %s, \"bands\": %d, \"channels\": %d, \"decimation\": %d, "
+                            "\"samples\": %lld, \"samples_per_s\": %s, \"ns_per_sample\": %s, "
+                            "\"block_ns_p50\": %s, \"block_ns_p99\": %s, \"block_ns_p999\": %s}%s\n",
+                         jsonString(r.stage).c_str(), jsonString(r.sweep).c_str(), c.sampleRate, c.blockSize,
+                         jsonNumber(c.rollDur, "%g").c_str(), c.numBands, c.numChannels, c.decimation, r.samples,
+                         jsonNumber(r.samples / r.seconds, "%.6g").c_str(),
+                         jsonNumber(r.seconds * 1e9 / r.samples, "%.4f").c_str(), jsonNumber(r.p50, "%.0f").c_str(),
+                         jsonNumber(r.p99, "%.0f").c_str(), jsonNumber(r.p999, "%.0f").c_str(),
+                         i + 1 < results.size() ? "," : "");
+        }
+
+        std::fprintf(f, "  ],\n");
+        std::fprintf(f, "  \"denormals\": [\n");
+
+        for (size_t i = 0; i < denormals.size(); i++)
+        {
+            const DenormalResult& r = denormals[i];
+            std::fprintf(f, "    {\"policy\": %s, \"input\": %s, \"ns_per_sample\": %s, "
+                            "\"max_error\": %s}%s\n",
+                         jsonString(r.policy).c_str(), jsonString(r.input).c_str(),
+                         jsonNumber(r.nsPerSample, "%.4f").c_str(), jsonNumber(r.maxError, "%.4g").c_str(),
+                         i + 1 < denormals.size() ? "," : "");
+        }
+
+        std::fprintf(f, "  ],\n");
+        std::fprintf(f, "  \"offline_filters\": [\n");
+
+        for (size_t i = 0; i < offlineFilters.size(); i++)
+        {
+            const OfflineFilterResult& r = offlineFilters[i];
+            std::fprintf(f, "    {\"filter\": %s, \"reference\": %s, \"ns_per_sample\": %s, "
+                            "\"max_error\": %s, \"bound\": %s}%s\n",
+                         jsonString(r.filter).c_str(), jsonString(r.reference).c_str(),
+                         jsonNumber(r.nsPerSample, "%.4f").c_str(), jsonNumber(r.maxError, "%.4g").c_str(),
+                         jsonNumber(r.bound, "%.4g").c_str(), i + 1 < offlineFilters.size() ? "," : "");
+        }
+
+        std::fprintf(f, "  ]\n}\n");
+    }
+
+    const char* usage =
+        "usage: mbi-bench [options]\n"
+        "\n"
+        "  --json FILE      also write the results as JSON\n"
+        "  --label TEXT     label stored in the JSON, e.g. a commit id\n"
+        "  --stage NAME     only run one stage: engine, engine_outputs, band_filter, dsp_band_filters,\n"
+        "                   dsp_vector_filters, rolling_mean, exponential_mean,\n"
+        "                   cascaded_mean or adaptive_threshold,\n"
+        "                   or only compare the\n"
+        "                   denormal policies: denormals, or only check the offline filters\n"
+        "                   against their references: offline_filters\n"
+        "  --seconds S      seconds of signal to process per case (default 5)\n"
+        "  --quick          baseline configuration only\n";
+}
+
+int main(int argc, char** argv)
+{
+    std::string jsonPath;
+    std::string label;
+    std::string onlyStage;
+    double dataSeconds = 5;
+    bool quick = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--quick")
+            quick = true;
+        else if (i + 1 < argc && arg == "--json")
+            jsonPath = argv[++i];
+        else if (i + 1 < argc && arg == "--label")
+            label = argv[++i];
+        else if (i + 1 < argc && arg == "--stage")
+            onlyStage = argv[++i];
+        else if (i + 1 < argc && arg == "--seconds")
+            dataSeconds = std::atof(argv[++i]);
+        else
+        {
+            std::fputs(usage, stderr);
+            return 1;
+        }
+    }
+
+    const char* stageNames[] = { "engine", "engine_outputs", "band_filter", "dsp_band_filters", "dsp_vector_filters", "rolling_mean",
+                                "exponential_mean", "cascaded_mean", "adaptive_threshold" };
+
+    std::printf("%-18s %-11s %6s %6s %6s %3s %4s %4s %10s %8s %10s %10s %10s\n",
+                "stage", "sweep", "rate", "block", "win", "bnd", "chan", "dec",
+                "samples/s", "ns/samp", "p50 ns", "p99 ns", "p99.9 ns");
+
+    std::vector<Result> results;
+    for (const char* stageName : stageNames)
+    {
+        const std::string stage = stageName;
+        if (!onlyStage.empty() && stage != onlyStage)
+            continue;
+
+        const bool isMean = stage == "rolling_mean" || stage == "exponential_mean" || stage == "cascaded_mean";
+        const bool usesBands = !isMean && stage != "adaptive_threshold";
+        const bool usesWindow = stage == "engine" || stage == "engine_outputs" || isMean;
+
+        std::vector<std::pair<std::string, Config> > cases;
+        cases.push_back(std::make_pair(std::string("baseline"), Config()));
+
+        if (!quick)
+        {
+            const int blockSizes[] = { 64, 256, 4096 };
+            const int sampleRates[] = { 1000, 5000, 10000 };
+            const float windows[] = { 100, 5000, 10000 };
+            const int bandCounts[] = { 1, 8, 16 };
+            const int channelCounts[] = { 4, 16, 64 };
+            const int decimations[] = { 4, 16, 64 };
+
+            for (int v : blockSizes)
+            {
+                Config c;
+                c.blockSize = v;
+                cases.push_back(std::make_pair(std::string("block_size"), c));
+            }
+            for (int v : sampleRates)
+            {
+                Config c;
+                c.sampleRate = v;
+                cases.push_back(std::make_pair(std::string("sample_rate"), c));
+            }
+            if (usesWindow)
+            {
+                for (float v : windows)
+                {
+                    Config c;
+                    c.rollDur = v;
+                    cases.push_back(std::make_pair(std::string("window"), c));
+                }
+            }
+            if (usesBands)
+            {
+                for (int v : bandCounts)
+                {
+                    Config c;
+                    c.numBands = v;
+                    cases.push_back(std::make_pair(std::string("bands"), c));
+                }
+            }
+            for (int v : channelCounts)
+            {
+                Config c;
+                c.numChannels = v;
+                cases.push_back(std::make_pair(std::string("channels"), c));
+            }
+            if (stage == "engine")
+            {
+                for (int v : decimations)
+                {
+                    Config c;
+                    c.decimation = v;
+                    cases.push_back(std::make_pair(std::string("decimation"), c));
+                }
+            }
+        }
+
+        for (size_t i = 0; i < cases.size(); i++)
+        {
+            Result result;
+            if (!run(stage, cases[i].first, cases[i].second, dataSeconds, result))
+                continue;
+            results.push_back(result);
+            printResult(result);
+        }
+    }
+
+    std::vector<DenormalResult> denormals;
+    if (onlyStage.empty() || onlyStage == "denormals")
+        denormals = runDenormalPolicies(dataSeconds);
+
+    std::vector<OfflineFilterResult> offlineFilters;
+    if (onlyStage.empty() || onlyStage == "offline_filters")
+        offlineFilters = runOfflineFilters(dataSeconds);
+
+    if (!jsonPath.empty())
+    {
+        FILE* f = std::fopen(jsonPath.c_str(), "w");
+        if (f == nullptr)
+        {
+            std::fprintf(stderr, "mbi-bench: can't create %s\n", jsonPath.c_str());
+            return 1;
+        }
+        writeJson(f, results, denormals, offlineFilters, label);
+        std::fclose(f);
+    }
+
+    // so that make check fails when an offline filter drifts from its reference
+    for (const OfflineFilterResult& r : offlineFilters)
+    {
+        if (!(r.maxError <= r.bound))
+        {
+            std::fprintf(stderr, "mbi-bench: %s filter is %g away from its reference (bound %g)\n",
+                         r.filter.c_str(), r.maxError, r.bound);
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,601 @@
+/*
+------------------------------------------------------------------
+
+This file is part of a plugin for the Open Ephys GUI
+Copyright (C) 2017 Translational NeuroEngineering Laboratory, MGH
+
+------------------------------------------------------------------
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*/
+
+// Offline multi-band integrator.
+// Runs the plugin's signal path (see IntegratorEngine and IntegratorSettings) over a raw recording as
+// fast as possible, without Open Ephys. Input is a headerless file of interleaved samples, such as an
+// Open Ephys binary-format continuous.dat; output is interleaved float32, one column per integrated
+// channel. Given the same input samples and settings, the output is bit-identical to the plugin's.
+
+#include "IntegratorSettings.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    const char* usage =
+        "usage: mbi-offline [options] <input> <output>\n"
+        "\n"
+        "  -r, --rate HZ          input sample rate (required)\n"
+        "  -c, --channels N       number of interleaved channels in the input (default 1)\n"
+        "  -s, --select LIST      comma-separated, 0-based channels to integrate (default all)\n"
+        "  -f, --format FMT       input sample format: int16 or float32 (default int16)\n"
+        "      --scale X          microvolts per int16 step (default 0.195)\n"
+        "  -w, --window MS        rolling window duration (default 1000)\n"
+        "  -b, --band LO:HI:GAIN  frequency band; repeat for each band (default 6:9:1 13:18:1 1:4:1)\n"
+        "  -d, --decimation N     decimate by N before filtering (default 1 = off)\n"
+        "  -k, --kernel NAME      average over the window with: rolling (default), exponential, or\n"
+        "                         cascade2, cascade3, cascade4 (that many rolling means in a row)\n"
+        "      --block N          samples per processing block (default 1024; doesn't change the output)\n"
+        "      --sum FILE         also write the weighted band sum before averaging, as float32\n"
+        "      --extra-window MS  also compute the output over this window duration; repeat for each\n"
+        "                         window (up to 8)\n"
+        "      --windows FILE     write the output over the extra windows, as float32, one value per\n"
+        "                         channel and window for each sample\n"
+        "      --stats FILE       also write the band sum's rolling mean, variance, rms, skewness and\n"
+        "                         kurtosis over the window, as 5 float32 per channel and sample\n"
+        "      --threshold FILE   also write the adaptive threshold (running percentile of the output),\n"
+        "                         as float32\n"
+        "      --level PCT        percentile followed by the threshold (default 99)\n"
+        "      --horizon S        time over which the threshold forgets older output (default 0 = never)\n"
+        "      --timing FILE      write block timing statistics (needs a build with MBI_PROFILING)\n"
+        "      --deadline X       fraction of a block's duration that counts as an overrun (default 0.5)\n"
+        "\n"
+        "int16 samples are converted as sample * scale in single precision. For output identical to a\n"
+        "live session, the input must hold the same sample values the plugin received.\n";
+
+    struct Options
+    {
+        Options()
+            : sampleRate   (0)
+            , numChannels  (1)
+            , int16Input   (true)
+            , scale        (0.195f)
+            , blockSize    (1024)
+            , deadline     (0.5f)
+        {}
+
+        IntegratorSettings settings;
+        int sampleRate;
+        int numChannels;
+        std::vector<int> selected;
+        bool int16Input;
+        float scale;
+        int blockSize;
+        float deadline;
+        std::string inputPath;
+        std::string outputPath;
+        std::string sumPath;
+        std::string statsPath;
+        std::string windowsPath;
+        std::string thresholdPath;
+        std::string timingPath;
+    };
+
+    bool fail(const char* message, const char* detail = "")
+    {
+        std::fprintf(stderr, "mbi-offline: %s%s\n", message, detail);
+        return false;
+    }
+
+    // closes a stream, or does nothing for null; false if any read or write on it failed
+    bool closeStream(FILE* f)
+    {
+        if (f == nullptr)
+            return true;
+
+        const bool ok = !std::ferror(f);
+        return std::fclose(f) == 0 && ok;
+    }
+
+    bool parseInt(const char* text, int min, int max, int* out)
+    {
+        char* end;
+        long value = std::strtol(text, &end, 10);
+        if (end == text || *end != '\0' || value < min || value > max)
+            return false;
+        *out = static_cast<int>(value);
+        return true;
+    }
+
+    bool parseFloat(const char* text, float* out)
+    {
+        char* end;
+        *out = std::strtof(text, &end);
+        return end != text && *end == '\0';
+    }
+
+    bool parseOptions(int argc, char** argv, Options& options)
+    {
+        std::vector<FrequencyBand> bands;
+        std::vector<std::string> positional;
+
+        for (int i = 1; i < argc; i++)
+        {
+            std::string arg = argv[i];
+            if (arg.size() < 2 || arg[0] != '-')
+            {
+                positional.push_back(arg);
+                continue;
+            }
+
+            if (i + 1 >= argc)
+                return fail("missing value for ", argv[i]);
+            const char* value = argv[++i];
+
+            if (arg == "-r" || arg == "--rate")
+            {
+                if (!parseInt(value, 1, 10000000, &options.sampleRate))
+                    return fail("invalid sample rate: ", value);
+            }
+            else if (arg == "-c" || arg == "--channels")
+            {
+                if (!parseInt(value, 1, 100000, &options.numChannels))
+                    return fail("invalid channel count: ", value);
+            }
+            else if (arg == "-s" || arg == "--select")
+            {
+                std::string list = value;
+                size_t start = 0;
+                while (start <= list.size())
+                {
+                    size_t comma = list.find(',', start);
+                    if (comma == std::string::npos)
+                        comma = list.size();
+
+                    int chan;
+                    if (!parseInt(list.substr(start, comma - start).c_str(), 0, 100000, &chan))
+                        return fail("invalid channel list: ", value);
+                    options.selected.push_back(chan);
+                    start = comma + 1;
+                }
+            }
+            else if (arg == "-f" || arg == "--format")
+            {
+                if (std::strcmp(value, "int16") == 0)
+                    options.int16Input = true;
+                else if (std::strcmp(value, "float32") == 0)
+                    options.int16Input = false;
+                else
+                    return fail("unknown format: ", value);
+            }
+            else if (arg == "--scale")
+            {
+                if (!parseFloat(value, &options.scale))
+                    return fail("invalid scale: ", value);
+            }
+            else if (arg == "-w" || arg == "--window")
+            {
+                if (!parseFloat(value, &options.settings.rollDur) || options.settings.rollDur < 0
+                    || options.settings.rollDur > IntegratorSettings::maxRollDur)
+                    return fail("invalid window duration: ", value);
+            }
+            else if (arg == "-b" || arg == "--band")
+            {
+                FrequencyBand band;
+                std::string spec = value;
+                size_t first = spec.find(':');
+                size_t second = first == std::string::npos ? first : spec.find(':', first + 1);
+                if (second == std::string::npos
+                    || !parseFloat(spec.substr(0, first).c_str(), &band.low)
+                    || !parseFloat(spec.substr(first + 1, second - first - 1).c_str(), &band.high)
+                    || !parseFloat(spec.substr(second + 1).c_str(), &band.gain))
+                    return fail("invalid band (expected LOW:HIGH:GAIN): ", value);
+                bands.push_back(band);
+            }
+            else if (arg == "-d" || arg == "--decimation")
+            {
+                if (!parseInt(value, 1, IntegratorSettings::maxDecimation, &options.settings.decimation))
+                    return fail("invalid decimation factor: ", value);
+            }
+            else if (arg == "-k" || arg == "--kernel")
+            {
+                const std::string kernel = value;
+                if (kernel == "rolling")
+                    options.settings.integratorMode = IntegratorEngine::rollingMode;
+                else if (kernel == "exponential")
+                    options.settings.integratorMode = IntegratorEngine::exponentialMode;
+                else if (kernel.compare(0, 7, "cascade") == 0
+                         && parseInt(kernel.c_str() + 7, CascadedLineLength::minStages,
+                                     CascadedLineLength::maxStages, &options.settings.cascadeStages))
+                    options.settings.integratorMode = IntegratorEngine::cascadedMode;
+                else
+                    return fail("unknown kernel: ", value);
+            }
+            else if (arg == "--block")
+            {
+                if (!parseInt(value, 1, 1 << 20, &options.blockSize))
+                    return fail("invalid block size: ", value);
+            }
+            else if (arg == "--sum")
+            {
+                options.sumPath = value;
+            }
+            else if (arg == "--extra-window")
+            {
+                float duration;
+                if (!parseFloat(value, &duration) || duration < 0 || duration > IntegratorSettings::maxRollDur)
+                    return fail("invalid window duration: ", value);
+                if (options.settings.extraRollDurs.size() == MultiWindowLineLength::maxWindows)
+                    return fail("too many extra windows at ", value);
+                options.settings.extraRollDurs.push_back(duration);
+            }
+            else if (arg == "--windows")
+            {
+                options.windowsPath = value;
+            }
+            else if (arg == "--stats")
+            {
+                options.statsPath = value;
+            }
+            else if (arg == "--threshold")
+            {
+                options.thresholdPath = value;
+            }
+            else if (arg == "--level")
+            {
+                float level;
+                if (!parseFloat(value, &level) || level <= 0 || level >= 100)
+                    return fail("invalid percentile: ", value);
+                options.settings.thresholdLevel = level;
+            }
+            else if (arg == "--horizon")
+            {
+                float horizon;
+                if (!parseFloat(value, &horizon) || horizon < 0 || horizon > IntegratorSettings::maxThresholdHorizon)
+                    return fail("invalid horizon: ", value);
+                options.settings.thresholdHorizon = horizon;
+            }
+            else if (arg == "--timing")
+            {
+#ifndef MBI_PROFILING
+                return fail("--timing needs a build with MBI_PROFILING (make CXXFLAGS=-DMBI_PROFILING)");
+#endif
+                options.timingPath = value;
+            }
+            else if (arg == "--deadline")
+            {
+                if (!parseFloat(value, &options.deadline) || options.deadline <= 0)
+                    return fail("invalid deadline fraction: ", value);
+            }
+            else
+            {
+                return fail("unknown option: ", argv[i - 1]);
+            }
+        }
+
+        if (positional.size() != 2)
+            return fail("expected an input and an output file");
+        options.inputPath = positional[0];
+        options.outputPath = positional[1];
+
+        if (options.sampleRate == 0)
+            return fail("the sample rate (--rate) is required");
+
+        if (!bands.empty())
+        {
+            if (bands.size() > IntegratorSettings::maxBands)
+                return fail("too many bands");
+            options.settings.bands = bands;
+        }
+
+        if (options.selected.empty())
+        {
+            for (int chan = 0; chan < options.numChannels; chan++)
+                options.selected.push_back(chan);
+        }
+
+        for (int chan : options.selected)
+        {
+            if (chan >= options.numChannels)
+                return fail("selected channel is not in the input");
+        }
+
+        return true;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    Options options;
+    if (argc < 2 || !parseOptions(argc, argv, options))
+    {
+        std::fputs(usage, stderr);
+        return 1;
+    }
+
+    FILE* input = std::fopen(options.inputPath.c_str(), "rb");
+    if (input == nullptr)
+    {
+        fail("can't open ", options.inputPath.c_str());
+        return 1;
+    }
+
+    FILE* output = std::fopen(options.outputPath.c_str(), "wb");
+    if (output == nullptr)
+    {
+        fail("can't create ", options.outputPath.c_str());
+        return 1;
+    }
+
+    FILE* sumOutput = nullptr;
+    if (!options.sumPath.empty())
+    {
+        sumOutput = std::fopen(options.sumPath.c_str(), "wb");
+        if (sumOutput == nullptr)
+        {
+            fail("can't create ", options.sumPath.c_str());
+            return 1;
+        }
+    }
+
+    FILE* statsOutput = nullptr;
+    if (!options.statsPath.empty())
+    {
+        statsOutput = std::fopen(options.statsPath.c_str(), "wb");
+        if (statsOutput == nullptr)
+        {
+            fail("can't create ", options.statsPath.c_str());
+            return 1;
+        }
+    }
+
+    FILE* windowsOutput = nullptr;
+    if (!options.windowsPath.empty())
+    {
+        if (options.settings.extraRollDurs.empty())
+        {
+            fail("--windows needs at least one --extra-window");
+            return 1;
+        }
+
+        windowsOutput = std::fopen(options.windowsPath.c_str(), "wb");
+        if (windowsOutput == nullptr)
+        {
+            fail("can't create ", options.windowsPath.c_str());
+            return 1;
+        }
+    }
+
+    FILE* thresholdOutput = nullptr;
+    if (!options.thresholdPath.empty())
+    {
+        thresholdOutput = std::fopen(options.thresholdPath.c_str(), "wb");
+        if (thresholdOutput == nullptr)
+        {
+            fail("can't create ", options.thresholdPath.c_str());
+            return 1;
+        }
+
+        if (!options.settings.hasThreshold())
+            options.settings.thresholdLevel = 99;
+    }
+
+    const int numInputs = options.numChannels;
+    const int numOutputs = static_cast<int>(options.selected.size());
+    const int blockSize = options.blockSize;
+
+    IntegratorEngine engine;
+    options.settings.applyTo(engine, numOutputs, options.sampleRate);
+    engine.setStatisticsEnabled(statsOutput != nullptr);
+
+    AdaptiveThreshold threshold;
+    threshold.prepare(numOutputs);
+    options.settings.applyThreshold(threshold, options.sampleRate);
+
+    // blocks are timed from reading the input to writing the output, against the time they span
+    ProcessTimer timer;
+    timer.setSampleRate(options.sampleRate);
+    timer.setDeadlineFraction(options.deadline);
+    engine.setTimer(&timer);
+
+    if (engine.getDecimationFactor() != options.settings.decimation)
+        std::fprintf(stderr, "mbi-offline: decimation lowered to %d to keep the bands in its passband\n",
+                     engine.getDecimationFactor());
+
+    // one block of interleaved input, the selected channels one after another, and interleaved output
+    const size_t sampleBytes = options.int16Input ? sizeof(int16_t) : sizeof(float);
+    std::vector<char> rawBlock(static_cast<size_t>(blockSize) * numInputs * sampleBytes);
+    std::vector<float> channelData(static_cast<size_t>(blockSize) * numOutputs);
+    std::vector<float> sumData(sumOutput != nullptr ? channelData.size() : 0);
+    std::vector<float> thresholdData(thresholdOutput != nullptr ? channelData.size() : 0);
+
+    const int numWindows = windowsOutput != nullptr ? engine.getNumExtraWindows() : 0;
+    std::vector<float> windowData(channelData.size() * numWindows);
+    std::vector<float> interleavedWindows(windowData.size());
+    std::vector<float> interleaved(channelData.size());
+
+    typedef RollingStatistics::Moments Moments;
+    const int numMoments = 5;   // mean, variance, rms, skewness, kurtosis
+    std::vector<Moments> statsData(statsOutput != nullptr ? channelData.size() : 0);
+    std::vector<float> interleavedStats(statsData.size() * numMoments);
+
+    std::vector<float*> channels(numOutputs);
+    std::vector<float*> sums(numOutputs);
+    std::vector<float*> thresholds(numOutputs);
+    std::vector<Moments*> stats(numOutputs);
+    std::vector<float*> windowChannels(static_cast<size_t>(numOutputs) * numWindows);
+    std::vector<float* const*> windows(numWindows);
+    for (int c = 0; c < numOutputs; c++)
+    {
+        channels[c] = &channelData[static_cast<size_t>(c) * blockSize];
+        if (sumOutput != nullptr)
+            sums[c] = &sumData[static_cast<size_t>(c) * blockSize];
+        if (thresholdOutput != nullptr)
+            thresholds[c] = &thresholdData[static_cast<size_t>(c) * blockSize];
+        if (statsOutput != nullptr)
+            stats[c] = &statsData[static_cast<size_t>(c) * blockSize];
+    }
+    for (int w = 0; w < numWindows; w++)
+    {
+        for (int c = 0; c < numOutputs; c++)
+            windowChannels[static_cast<size_t>(w) * numOutputs + c] = &windowData[(static_cast<size_t>(w) * numOutputs + c) * blockSize];
+        windows[w] = &windowChannels[static_cast<size_t>(w) * numOutputs];
+    }
+
+    long long totalFrames = 0;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    const size_t frameBytes = static_cast<size_t>(numInputs) * sampleBytes;
+    size_t partialBytes = 0;    // bytes at the end of the input that don't make up a whole frame
+
+    for (;;)
+    {
+        // read bytes rather than frames, so that a trailing partial frame can be reported
+        const size_t bytes = std::fread(rawBlock.data(), 1, rawBlock.size(), input);
+        const int nSamples = static_cast<int>(bytes / frameBytes);
+        partialBytes = bytes % frameBytes;
+        if (nSamples == 0)
+            break;
+
+        const ScopedStageTimer blockTimer(&timer, ProcessTimer::blockStage, nSamples);
+
+        // deinterleave the selected channels
+        for (int c = 0; c < numOutputs; c++)
+        {
+            const int chan = options.selected[c];
+            float* dest = channels[c];
+
+            if (options.int16Input)
+            {
+                const int16_t* src = reinterpret_cast<const int16_t*>(rawBlock.data()) + chan;
+                for (int i = 0; i < nSamples; i++, src += numInputs)
+                    dest[i] = *src * options.scale;
+            }
+            else
+            {
+                const float* src = reinterpret_cast<const float*>(rawBlock.data()) + chan;
+                for (int i = 0; i < nSamples; i++, src += numInputs)
+                    dest[i] = *src;
+            }
+        }
+
+        engine.process(channels.data(), channels.data(), nSamples,
+                       nullptr, sumOutput != nullptr ? sums.data() : nullptr,
+                       statsOutput != nullptr ? stats.data() : nullptr,
+                       windowsOutput != nullptr ? windows.data() : nullptr);
+
+        if (thresholdOutput != nullptr)
+            threshold.process(channels.data(), thresholds.data(), nSamples);
+
+        for (int c = 0; c < numOutputs; c++)
+        {
+            for (int i = 0; i < nSamples; i++)
+                interleaved[static_cast<size_t>(i) * numOutputs + c] = channels[c][i];
+        }
+        std::fwrite(interleaved.data(), sizeof(float) * numOutputs, nSamples, output);
+
+        if (sumOutput != nullptr)
+        {
+            for (int c = 0; c < numOutputs; c++)
+            {
+                for (int i = 0; i < nSamples; i++)
+                    interleaved[static_cast<size_t>(i) * numOutputs + c] = sums[c][i];
+            }
+            std::fwrite(interleaved.data(), sizeof(float) * numOutputs, nSamples, sumOutput);
+        }
+
+        if (windowsOutput != nullptr)
+        {
+            for (int w = 0; w < numWindows; w++)
+            {
+                for (int c = 0; c < numOutputs; c++)
+                {
+                    for (int i = 0; i < nSamples; i++)
+                        interleavedWindows[(static_cast<size_t>(i) * numOutputs + c) * numWindows + w] = windows[w][c][i];
+                }
+            }
+            std::fwrite(interleavedWindows.data(), sizeof(float) * numOutputs * numWindows, nSamples, windowsOutput);
+        }
+
+        if (thresholdOutput != nullptr)
+        {
+            for (int c = 0; c < numOutputs; c++)
+            {
+                for (int i = 0; i < nSamples; i++)
+                    interleaved[static_cast<size_t>(i) * numOutputs + c] = thresholds[c][i];
+            }
+            std::fwrite(interleaved.data(), sizeof(float) * numOutputs, nSamples, thresholdOutput);
+        }
+
+        if (statsOutput != nullptr)
+        {
+            for (int c = 0; c < numOutputs; c++)
+            {
+                for (int i = 0; i < nSamples; i++)
+                {
+                    const Moments& m = stats[c][i];
+                    float* dest = &interleavedStats[(static_cast<size_t>(i) * numOutputs + c) * numMoments];
+                    dest[0] = m.mean;
+                    dest[1] = m.variance;
+                    dest[2] = m.rms;
+                    dest[3] = m.skewness;
+                    dest[4] = m.kurtosis;
+                }
+            }
+            std::fwrite(interleavedStats.data(), sizeof(float) * numMoments * numOutputs, nSamples, statsOutput);
+        }
+
+        totalFrames += nSamples;
+        if (nSamples < blockSize)
+            break;
+    }
+
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const double recorded = static_cast<double>(totalFrames) / options.sampleRate;
+    std::fprintf(stderr, "mbi-offline: %lld samples x %d channels (%.1f s of data) in %.2f s, %.0fx real time\n",
+                 totalFrames, numOutputs, recorded, seconds, seconds > 0 ? recorded / seconds : 0.0);
+
+    // a recording cut short, or read with the wrong channel count or format, usually ends mid-frame
+    if (partialBytes != 0)
+        std::fprintf(stderr, "mbi-offline: warning: ignored %lu bytes at the end of the input, which is not a whole "
+                             "number of %d-channel frames (check --channels and --format)\n",
+                     static_cast<unsigned long>(partialBytes), numInputs);
+
+    bool ok = closeStream(input);
+    ok = closeStream(output) && ok;
+    ok = closeStream(sumOutput) && ok;
+    ok = closeStream(statsOutput) && ok;
+    ok = closeStream(thresholdOutput) && ok;
+    ok = closeStream(windowsOutput) && ok;
+
+    if (!ok)
+    {
+        fail("I/O error");
+        return 1;
+    }
+
+    if (!options.timingPath.empty() && !timer.writeReport(options.timingPath.c_str()))
+    {
+        fail("can't write timing to ", options.timingPath.c_str());
+        return 1;
+    }
+
+    return 0;
+}